@@ -4,8 +4,10 @@
 #include "alp.h"
 #include "AlpUserInterface.h"
 #include "AlpFrames.h"
+#ifdef _WIN32
 #include <conio.h>
 #include <crtdbg.h>
+#endif
 
 // Error handling policy: Quit, whenever an ALP error happens.
 // VERIFY_ALP also echoes each successfull ALP API call (in contrast to VERIFY_ALP_NO_ECHO)
@@ -0,0 +1,54 @@
+/**
+* @file AlpCommandQueue.cpp
+*
+* @brief Commands for a running projection, see AlpCommandQueue.h.
+*/
+
+#include "AlpCommandQueue.h"
+#include <algorithm>
+
+AlpCommandQueue::AlpCommandQueue()
+	: _completed(0), _total(0), _max(0) {
+}
+
+/**
+* @brief Appends a command and wakes the waiting thread. Callable from any thread.
+*
+* Commands are applied in the order they were posted. Commands posted while no projection
+* runs are applied when the next one starts.
+*/
+void AlpCommandQueue::post(const AlpCommand type, const long value) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_commands.push_back(tAlpCommand{ type, value, std::chrono::steady_clock::now() });
+	}
+	_posted.notify_one();
+}
+
+/**
+* @brief Takes the oldest command, waiting for one until `deadline`.
+*
+* @return bool, true if `command` was taken, false if the deadline passed without a command.
+*/
+bool AlpCommandQueue::wait(tAlpCommand& command, const std::chrono::steady_clock::time_point deadline) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (!_posted.wait_until(lock, deadline, [this] { return !_commands.empty(); }))
+		return false;
+	command = _commands.front();
+	_commands.pop_front();
+	return true;
+}
+
+// Records the reaction time of a command taken with wait, once it has been applied
+void AlpCommandQueue::done(tAlpCommand const& command) {
+	std::chrono::nanoseconds const latency = std::chrono::steady_clock::now() - command.Posted;
+	std::lock_guard<std::mutex> lock(_mutex);
+	_completed++;
+	_total += latency;
+	_max = std::max(_max, latency);
+}
+
+tAlpCommandStats AlpCommandQueue::stats() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return tAlpCommandStats{ _completed, _completed == 0 ? 0. : _total.count() / 1000. / _completed, _max.count() / 1000. };
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+* @file AlpCommandQueue.h
+*
+* @brief Thread-safe queue of commands for a running projection (Projector::display).
+*
+* Any thread posts commands; the display thread waits on the queue with a deadline, its next
+* monitoring tick. A post wakes it through a condition variable at once, so a command takes
+* effect within the latency of the ALP call it causes, independent of the monitoring period
+* and of the timer resolution of the operating system.
+*
+* The time from post to completion of every command is recorded, so the reaction time of the
+* projection is measurable (stats()).
+*
+* Usage:
+*
+*	// any thread
+*	queue.post(AlpCommand::Stop);
+*
+*	// display thread
+*	tAlpCommand command;
+*	while (queue.wait(command, nextTick)) {
+*		... apply command ...
+*		queue.done(command);
+*	}
+*/
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+enum class AlpCommand {
+	Stop,			/* end the projection */
+	Sequence,		/* project another uploaded sequence, Value: its ALP_ID */
+	Brightness		/* set the LED brightness, Value: [%] */
+};
+
+struct tAlpCommand {
+	AlpCommand Type;
+	long Value;
+	std::chrono::steady_clock::time_point Posted;
+};
+
+/**
+* @brief Reaction times of the completed commands.
+*/
+struct tAlpCommandStats {
+	unsigned long long Commands;	/* commands completed */
+	double Mean, Max;				/* [us] time from post to done */
+};
+
+class AlpCommandQueue {
+public:
+	AlpCommandQueue();
+
+	void post(const AlpCommand type, const long value = 0);
+	bool wait(tAlpCommand& command, const std::chrono::steady_clock::time_point deadline);
+	void done(tAlpCommand const& command);
+
+	tAlpCommandStats stats() const;
+
+private:
+	mutable std::mutex _mutex;
+	std::condition_variable _posted;
+	std::deque<tAlpCommand> _commands;
+	unsigned long long _completed;
+	std::chrono::nanoseconds _total, _max;
+};
@@ -0,0 +1,207 @@
+/**
+* @file AlpDisplayList.cpp
+*
+* @brief Display list of rectangle fills compiled into row spans, see AlpDisplayList.h.
+*/
+
+#include "AlpDisplayList.h"
+#include "AlpUserInterface.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+AlpDisplayList::AlpDisplayList(const long width, const long height)
+	: _width(width), _height(height), _compiled(false) {
+	try {
+		if (_width <= 0 || _height <= 0)
+			throw std::invalid_argument("Error: Projector dimensions must be positive integers.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+}
+
+/**
+* @brief Records a filled rectangle, with the same checks as AlpFrames::fillRect.
+*
+* @param x, y The top-left corner.
+* @param rectWidth, height The size; a height of zero or less records nothing.
+* @param pixelValue Gray value; binary frames switch the mirrors on if its most significant bit is set.
+*
+* @throws std::invalid_argument if the rectangle is not inside the frame or `rectWidth` is not positive.
+*/
+void AlpDisplayList::fillRect(const long x, const long y, const long rectWidth, const long height, const char unsigned pixelValue) {
+	try {
+		if (x < 0 || x + rectWidth > _width || y < 0 || y + height > _height)
+			throw std::invalid_argument("Error: Attempting to draw out of bounds.");
+		if (rectWidth <= 0)
+			throw std::invalid_argument("Error: `rectWidth` must be a positive integer.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	if (height <= 0)
+		return;
+	_commands.push_back({ x, y, rectWidth, height, pixelValue });
+	_compiled = false;
+}
+
+void AlpDisplayList::clear() {
+	_commands.clear();
+	_compiled = false;
+}
+
+// Avoids reallocations while recording patterns of known size
+void AlpDisplayList::reserve(const size_t commands) {
+	_commands.reserve(commands);
+}
+
+size_t AlpDisplayList::commandCount() const {
+	return _commands.size();
+}
+
+/**
+* @brief Builds the bands and their spans from the recorded commands.
+*
+* The set of rectangles covering a row only changes at their top and bottom edges, so a
+* sweep over these edges resolves the spans once per band rather than once per row.
+* Within a band, rectangles that do not overlap (the usual case for patterns) are simply
+* sorted by x; otherwise they are painted in recording order.
+*/
+void AlpDisplayList::compile() {
+	_bands.clear();
+	_spans.clear();
+
+	auto const topOf = [this](size_t index) { return _commands[index].y; };
+	auto const bottomOf = [this](size_t index) { return _commands[index].y + _commands[index].height; };
+	auto const byX = [](Span const& a, Span const& b) { return a.x < b.x; };
+
+	// patterns usually record row by row, which makes both orders sorted already
+	size_t const count = _commands.size();
+	std::vector<size_t> byTop(count), byBottom(count);
+	for (size_t i = 0; i < count; i++)
+		byTop[i] = byBottom[i] = i;
+	auto const topFirst = [&](size_t a, size_t b) { return topOf(a) < topOf(b); };
+	auto const bottomFirst = [&](size_t a, size_t b) { return bottomOf(a) < bottomOf(b); };
+	if (!std::is_sorted(byTop.begin(), byTop.end(), topFirst))
+		std::sort(byTop.begin(), byTop.end(), topFirst);
+	if (!std::is_sorted(byBottom.begin(), byBottom.end(), bottomFirst))
+		std::sort(byBottom.begin(), byBottom.end(), bottomFirst);
+
+	std::vector<size_t> active;	// commands covering the current band, in recording order
+	std::vector<Span> row;
+	size_t nextTop = 0, nextBottom = 0;
+	while (nextTop < count || nextBottom < count) {
+		long const top = nextTop < count ? std::min(topOf(byTop[nextTop]), bottomOf(byBottom[nextBottom])) : bottomOf(byBottom[nextBottom]);
+		// update the active set in one pass per edge, not per command
+		if (nextBottom < count && bottomOf(byBottom[nextBottom]) == top) {
+			while (nextBottom < count && bottomOf(byBottom[nextBottom]) == top)
+				nextBottom++;
+			active.erase(std::remove_if(active.begin(), active.end(), [&](size_t index) { return bottomOf(index) == top; }), active.end());
+		}
+		size_t const previous = active.size();
+		for (; nextTop < count && topOf(byTop[nextTop]) == top; nextTop++)
+			active.push_back(byTop[nextTop]);
+		std::sort(active.begin() + previous, active.end());
+		std::inplace_merge(active.begin(), active.begin() + previous, active.end());
+		if (active.empty())
+			continue;
+		long const bottom = nextTop < count ? std::min(topOf(byTop[nextTop]), bottomOf(byBottom[nextBottom])) : bottomOf(byBottom[nextBottom]);
+
+		row.clear();
+		for (size_t index : active)
+			row.push_back({ _commands[index].x, _commands[index].width, _commands[index].value });
+		if (!std::is_sorted(row.begin(), row.end(), byX))
+			std::sort(row.begin(), row.end(), byX);
+		for (size_t j = 1; j < row.size(); j++)
+			if (row[j - 1].x + row[j - 1].width > row[j].x) {
+				paint(active, row);
+				break;
+			}
+
+		// merge touching spans of the same value into one write
+		size_t const firstSpan = _spans.size();
+		for (auto const& span : row) {
+			if (_spans.size() > firstSpan) {
+				Span& last = _spans.back();
+				if (last.value == span.value && last.x + last.width == span.x) {
+					last.width += span.width;
+					continue;
+				}
+			}
+			_spans.push_back(span);
+		}
+		_bands.push_back({ top, bottom, firstSpan, _spans.size() });
+	}
+	_compiled = true;
+}
+
+/**
+* @brief Resolves overlapping commands of one band into sorted, non-overlapping spans.
+*
+* Each command replaces the parts of earlier spans it covers, as if they were drawn one after another.
+*/
+void AlpDisplayList::paint(std::vector<size_t> const& active, std::vector<Span>& row) {
+	row.clear();
+	for (size_t index : active) {
+		Command const& command = _commands[index];
+		long const left = command.x, right = command.x + command.width;
+		auto const first = std::partition_point(row.begin(), row.end(), [left](Span const& span) { return span.x + span.width <= left; });
+		auto last = first;
+		while (last != row.end() && last->x < right)
+			++last;
+
+		Span pieces[3];
+		int count = 0;
+		if (first != last && first->x < left)
+			pieces[count++] = { first->x, left - first->x, first->value };
+		pieces[count++] = { left, command.width, command.value };
+		if (first != last && (last - 1)->x + (last - 1)->width > right)
+			pieces[count++] = { right, (last - 1)->x + (last - 1)->width - right, (last - 1)->value };
+
+		auto const position = row.erase(first, last);
+		row.insert(position, pieces, pieces + count);
+	}
+}
+
+/**
+* @brief Draws the recorded commands into one frame, compiling them first if they changed.
+*
+* @param frames Frames with the dimensions of the display list, Gray8 or Binary.
+* @param frameNum The frame to draw into. Pixels outside all rectangles are left unchanged.
+*
+* @return int, 0 on success, otherwise 1 if the frame does not exist or the dimensions differ
+* (nothing is drawn).
+*/
+int AlpDisplayList::rasterize(AlpFrames& frames, const long frameNum) {
+	if (frames.checkFrames(frameNum, 1) != 0)
+		return 1;
+	if (frames._width != _width || frames._height != _height) {
+		std::cerr << "Error: Display list and frame dimensions differ." << std::endl;
+		return 1;
+	}
+
+	if (!_compiled)
+		compile();
+
+	bool const binary = frames._format == AlpFrames::PixelFormat::Binary;
+	for (auto const& band : _bands)
+		for (long y = band.top; y < band.bottom; y++) {
+			char unsigned* const row = frames.row(frameNum, y);
+			for (size_t i = band.firstSpan; i < band.lastSpan; i++) {
+				Span const& span = _spans[i];
+				if (binary)
+					frames.fillRowBits(row, span.x, span.width, (span.value & 0x80) != 0);
+				else
+					memset(row + span.x, span.value, span.width);
+			}
+		}
+	frames.markModified(frameNum);
+	return 0;
+}
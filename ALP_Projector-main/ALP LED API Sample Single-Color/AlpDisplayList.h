@@ -0,0 +1,59 @@
+#pragma once
+
+/**
+* @file AlpDisplayList.h
+*
+* @brief Records rectangle fills and rasterizes them in one pass over the rows.
+*
+* Each fillRect is validated once when it is recorded. Before the first rasterization
+* the commands are compiled into horizontal bands: runs of rows covered by the same
+* rectangles share one sorted list of non-overlapping spans, with later commands painted
+* over earlier ones. Rasterizing then writes every span of every row with a single memset
+* (or masked bytes plus memset for binary frames), so the cost grows with the rows and
+* spans drawn instead of with the number of primitives.
+*
+* A compiled list can be rasterized into any number of frames of the same dimensions.
+*/
+
+#include "AlpFrames.h"
+#include <vector>
+
+class AlpDisplayList {
+public:
+	AlpDisplayList(const long width, const long height);
+
+	void fillRect(const long x, const long y, const long rectWidth, const long height, const char unsigned pixelValue);
+	void clear();
+	void reserve(const size_t commands);
+
+	size_t commandCount() const;
+
+	int rasterize(AlpFrames& frames, const long frameNum);
+
+	const long _width, _height;
+
+private:
+	struct Command {
+		long x, y, width, height;
+		char unsigned value;
+	};
+
+	struct Span {
+		long x, width;
+		char unsigned value;
+	};
+
+	// rows [top, bottom) are all drawn with _spans[firstSpan, lastSpan)
+	struct Band {
+		long top, bottom;
+		size_t firstSpan, lastSpan;
+	};
+
+	void compile();
+	void paint(std::vector<size_t> const& active, std::vector<Span>& row);
+
+	std::vector<Command> _commands;
+	std::vector<Band> _bands;
+	std::vector<Span> _spans;
+	bool _compiled;
+};
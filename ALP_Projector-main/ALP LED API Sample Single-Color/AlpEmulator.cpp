@@ -0,0 +1,1267 @@
+/**
+* @file AlpEmulator.cpp
+*
+* @brief Software model of an ALP V-Module, see AlpEmulator.h.
+*
+* All state lives in one emulated device guarded by a single mutex. Projection does
+* not need a thread of its own: the frames shown up to "now" follow from the start
+* time and picture time of each run, so every API call first brings the projection
+* state up to date (AdvanceProjection) and then acts on it.
+*/
+
+#include "AlpEmulator.h"
+
+#ifdef ALP_EMULATOR
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const long long kInfinite = -1;				// EmuRun::total of AlpProjStartCont
+const long long kNoSwitch = -1;				// EmuRun::pendingSwitch while no trigger is stored
+const long kDefaultPictureTime = 33334;		// [us], ALP_DEFAULT picture time
+const long kMaxPictureTime = 10000000;		// [us]
+const long kDarkPhase = 8;					// [us], binary normal mode dark phase between two pictures
+const long kMaxSynchDelay = 130000;			// [us]
+const long kMaxTriggerInDelay = 130000;		// [us]
+const long kMaxLeds = 3;
+
+struct EmuSequence {
+	long bitPlanes, picNum;
+	long illuminateTime, pictureTime, synchDelay, synchPulseWidth, triggerInDelay;
+	long bitNum, binMode, dataFormat, firstFrame, lastFrame, repeat, putLock;
+	long firstLine, lastLine, lineInc;		// line scrolling, off while lineInc is 0
+	long aoiStart, aoiRows;					// ALP_SEQ_DMD_LINES
+	std::map<long, long> controls;			// settings that are stored, but not modelled
+	std::vector<char unsigned> data;		// only with tAlpEmuConfig::RetainImageData
+	int putsInProgress;
+};
+
+struct EmuRun {
+	ALP_ID sequenceId, queueId;
+	long long enqueued, start, pictureTime, illuminateTime;	// [ns]
+	long firstFrame, frames;				// frames per iteration
+	long long firstRow, lineInc;			// scrolling window, see ScrollRange
+	long long total;						// frames of the whole run, or kInfinite
+	long long shown;						// frames already logged
+	bool restart;
+	bool triggered, slave;					// paced by the trigger input (ALP_PROJ_STEP or ALP_SLAVE)
+	long long triggerInDelay;				// [ns]
+	long long frameStart, pendingSwitch;	// [ns] of a triggered run: current frame, next switch or kNoSwitch
+};
+
+struct EmuLed {
+	long type, contCurrent, setCurrent, brightness, forceOff;
+	tAlpHldAllocParams allocParams;
+	double junctionTemp, refTemp;			// [degC]
+	long long lastUpdate;					// [ns]
+};
+
+struct EmuDevice {
+	bool allocated;
+	ALP_ID id;
+	long dmdType, width, height;
+	Clock::time_point epoch;
+	std::map<long, long> controls;
+	std::map<long, tAlpDynSynchOutGate> synchGates;
+
+	std::map<ALP_ID, EmuSequence> sequences;
+	ALP_ID nextSequenceId;
+	long usedMemory;						// [binary pictures]
+
+	long projMode, projSync, queueMode, projStep;
+	std::map<long, long> projControls;
+	bool hasActive;
+	EmuRun active;
+	std::deque<EmuRun> waiting;
+	long long idleSince;					// end of the last run [ns], -1 after a halt
+	ALP_ID nextQueueId, lastQueueId;
+	unsigned long haltCount;
+
+	long long usbFreeAt;					// [ns]
+	std::map<ALP_ID, EmuLed> leds;
+	ALP_ID nextLedId;
+};
+
+std::mutex gMutex;
+tAlpEmuConfig gConfig = AlpEmuDefaultConfig();
+EmuDevice gDev;
+std::vector<tAlpEmuFrameEvent> gFrameLog;
+unsigned long long gDroppedFrames = 0;
+tAlpEmuUsbStats gUsbStats = {};
+tAlpEmuTriggerStats gTriggerStats = {};
+long long gTriggerLatencySum = 0;			// [ns]
+
+long long Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - gDev.epoch).count();
+}
+
+void SleepUntil(long long deviceTime) {
+	std::this_thread::sleep_until(gDev.epoch + std::chrono::nanoseconds(deviceTime));
+}
+
+bool DmdSize(long dmdType, long& width, long& height) {
+	switch (dmdType) {
+	case ALP_DMDTYPE_XGA: case ALP_DMDTYPE_XGA_07A: case ALP_DMDTYPE_XGA_055A: case ALP_DMDTYPE_XGA_055X:
+		width = 1024; height = 768; return true;
+	case ALP_DMDTYPE_SXGA_PLUS:
+		width = 1400; height = 1050; return true;
+	case ALP_DMDTYPE_1080P_095A: case ALP_DMDTYPE_1080P_065A: case ALP_DMDTYPE_1080P_065_S600: case ALP_DMDTYPE_DISCONNECT:
+		width = 1920; height = 1080; return true;
+	case ALP_DMDTYPE_WUXGA_096A:
+		width = 1920; height = 1200; return true;
+	case ALP_DMDTYPE_WQXGA_400MHZ_090A: case ALP_DMDTYPE_WQXGA_480MHZ_090A:
+		width = 2560; height = 1600; return true;
+	case ALP_DMDTYPE_WXGA_S450:
+		width = 1280; height = 800; return true;
+	default:
+		return false;
+	}
+}
+
+// One row of ALP_DATA_BINARY_* data, including the padding documented in alp.h
+long BinaryRowBytes() {
+	switch (gDev.width) {
+	case 1400: return 176;
+	case 1920: return 256;
+	default: return gDev.width / 8;
+	}
+}
+
+long RowBytes(EmuSequence const& seq) {
+	if (seq.dataFormat == ALP_DATA_BINARY_TOPDOWN || seq.dataFormat == ALP_DATA_BINARY_BOTTOMUP)
+		return BinaryRowBytes();
+	return gDev.width;
+}
+
+// Rows loaded per picture, i.e. the area of interest
+long DisplayRows(EmuSequence const& seq) {
+	return seq.aoiRows;
+}
+
+// Loading all rows once per displayed bit-plane, plus the illumination of the gray-scale bit weights
+long MinPictureTime(EmuSequence const& seq) {
+	double const rowLoad = DisplayRows(seq) * gConfig.RowLoadTime / 1000.;
+	double time = rowLoad * seq.bitNum;
+	if (seq.bitNum > 1)
+		time += gConfig.MinLsbTime * ((1L << seq.bitNum) - 1);
+	return (long)std::ceil(time);
+}
+
+// Scrolling treats the pictures as one image of picNum * height rows. A window of one DMD
+// height starts at FIRSTFRAME/FIRSTLINE and moves down by LINE_INC rows per displayed frame,
+// up to LASTFRAME/LASTLINE; the window must stay within the sequence.
+bool ScrollRange(EmuSequence const& seq, long long& firstRow, long& frames) {
+	firstRow = (long long)seq.firstFrame * gDev.height + seq.firstLine;
+	long long const lastRow = (long long)seq.lastFrame * gDev.height + seq.lastLine;
+	if (lastRow < firstRow || lastRow + gDev.height > (long long)seq.picNum * gDev.height)
+		return false;
+	frames = (long)((lastRow - firstRow) / seq.lineInc + 1);
+	return true;
+}
+
+long DarkPhase(EmuSequence const& seq) {
+	return seq.binMode == ALP_BIN_UNINTERRUPTED ? 0 : kDarkPhase;
+}
+
+long MinIlluminateTime(EmuSequence const& seq) {
+	return std::max(1L, MinPictureTime(seq) - DarkPhase(seq));
+}
+
+EmuSequence* FindSequence(ALP_ID DeviceId, ALP_ID SequenceId) {
+	if (!gDev.allocated || DeviceId != gDev.id)
+		return nullptr;
+	auto it = gDev.sequences.find(SequenceId);
+	return it == gDev.sequences.end() ? nullptr : &it->second;
+}
+
+EmuLed* FindLed(ALP_ID DeviceId, ALP_ID LedId) {
+	if (!gDev.allocated || DeviceId != gDev.id)
+		return nullptr;
+	auto it = gDev.leds.find(LedId);
+	return it == gDev.leds.end() ? nullptr : &it->second;
+}
+
+bool ValidDevice(ALP_ID DeviceId) {
+	return gDev.allocated && DeviceId == gDev.id;
+}
+
+// Records frame `k` of `run`, starting at `time`
+void LogFrame(EmuRun const& run, long long k, long long time) {
+	if (gFrameLog.size() >= gConfig.MaxFrameLog) {
+		gDroppedFrames++;
+		return;
+	}
+	tAlpEmuFrameEvent event;
+	event.Time = time;
+	event.SequenceId = run.sequenceId;
+	event.QueueId = run.queueId;
+	event.Frame = run.firstFrame + (long)(k % run.frames);
+	event.Line = 0;
+	if (run.lineInc != 0) {
+		long long const row = run.firstRow + k % run.frames * run.lineInc;
+		event.Frame = (long)(row / gDev.height);
+		event.Line = (long)(row % gDev.height);
+	}
+	event.PictureTime = (long)(run.pictureTime / 1000);
+	event.Restart = run.restart && k == 0;
+	gFrameLog.push_back(event);
+}
+
+void LogFrames(EmuRun& run, long long due) {
+	for (long long k = run.shown; k < due; k++)
+		LogFrame(run, k, run.start + k * run.pictureTime);
+	run.shown = std::max(run.shown, due);
+}
+
+/**
+* @brief Brings a run paced by the trigger input up to `now`.
+*
+* Frames switch only at stored triggers (see AlpEmuTrigger). With ALP_PROJ_STEP, a trigger
+* after the last frame ends the run; in ALP_SLAVE mode, the run ends once the last frame has
+* been shown for its picture time.
+*
+* @return bool, true if the run has ended.
+*/
+bool AdvanceTriggeredRun(EmuRun& run, long long now) {
+	if (run.pendingSwitch != kNoSwitch && now >= run.pendingSwitch) {
+		long long const at = run.pendingSwitch;
+		run.pendingSwitch = kNoSwitch;
+		if (run.total != kInfinite && run.shown >= run.total) {
+			gDev.idleSince = at;
+			return true;
+		}
+		LogFrame(run, run.shown++, at);
+		run.frameStart = at;
+	}
+	if (run.slave && run.total != kInfinite && run.shown >= run.total && run.pendingSwitch == kNoSwitch &&
+		now >= run.frameStart + run.pictureTime) {
+		gDev.idleSince = run.frameStart + run.pictureTime;
+		return true;
+	}
+	return false;
+}
+
+// Frame of `run` shown at `now`, counted from the start of the run
+long long CurrentFrame(EmuRun const& run, long long now) {
+	if (run.triggered)
+		return std::max(0LL, run.shown - 1);
+	return std::max(0LL, (now - run.start) / run.pictureTime);
+}
+
+// Device time at which a finite run ends, for waiting on it; triggered runs end at an unknown time
+long long RunEnd(EmuRun const& run) {
+	if (run.total == kInfinite || run.triggered)
+		return kInfinite;
+	return run.start + run.total * run.pictureTime;
+}
+
+/**
+* @brief Brings the projection state up to the device time `now`.
+*
+* Logs all frames that started until `now`, retires finished runs and starts the
+* next waiting one. A waiting run starts when the previous one ends, or when it was
+* enqueued if the host was late; the latter shows up as a gap in the frame log.
+*/
+void AdvanceProjection(long long now) {
+	for (;;) {
+		if (!gDev.hasActive) {
+			if (gDev.waiting.empty())
+				return;
+			EmuRun run = gDev.waiting.front();
+			gDev.waiting.pop_front();
+			run.restart = gDev.idleSince < 0;
+			run.start = std::max(run.enqueued, gDev.idleSince);
+			// step mode shows the first frame right away, slave mode waits for a trigger
+			if (run.triggered && !run.slave)
+				run.pendingSwitch = run.start;
+			gDev.active = run;
+			gDev.hasActive = true;
+		}
+
+		EmuRun& run = gDev.active;
+		if (run.triggered) {
+			if (!AdvanceTriggeredRun(run, now))
+				return;
+			gDev.hasActive = false;
+			continue;
+		}
+		long long due = now < run.start ? 0 : (now - run.start) / run.pictureTime + 1;
+		if (run.total != kInfinite)
+			due = std::min(due, run.total);
+		LogFrames(run, due);
+
+		if (run.total == kInfinite)
+			return;
+		long long const end = run.start + run.total * run.pictureTime;
+		if (now < end)
+			return;
+		gDev.idleSince = end;
+		gDev.hasActive = false;
+	}
+}
+
+// Ends the active run after the current iteration (or frame), counted from `now`
+void CutActiveRun(long long now, bool afterFrame) {
+	EmuRun& run = gDev.active;
+	long long const current = CurrentFrame(run, now);
+	long long total = afterFrame ? current + 1 : (current / run.frames + 1) * run.frames;
+	if (run.total != kInfinite)
+		total = std::min(total, run.total);
+	run.total = total;
+}
+
+bool SequenceInUse(ALP_ID SequenceId) {
+	if (gDev.hasActive && gDev.active.sequenceId == SequenceId)
+		return true;
+	for (auto const& run : gDev.waiting)
+		if (run.sequenceId == SequenceId)
+			return true;
+	return false;
+}
+
+void HaltProjection(long long now) {
+	AdvanceProjection(now);
+	gDev.hasActive = false;
+	gDev.waiting.clear();
+	gDev.idleSince = -1;
+	gDev.haltCount++;
+}
+
+void UpdateLedTemperature(EmuLed& led, long long now) {
+	bool const on = led.forceOff != ALP_LED_OFF && led.setCurrent > 0 && led.brightness > 0;
+	double const current = on ? led.setCurrent * led.brightness / 100. / 1000. : 0.;
+	double const power = gConfig.LedForwardVoltage * current;
+	double const dt = (now - led.lastUpdate) / 1e9;
+	double const alpha = 1. - std::exp(-dt / gConfig.ThermalTimeConstant);
+	double const junctionSteady = gConfig.AmbientTemperature + gConfig.ThermalResistance * power;
+	double const refSteady = gConfig.AmbientTemperature + 0.6 * gConfig.ThermalResistance * power;
+	led.junctionTemp += (junctionSteady - led.junctionTemp) * alpha;
+	led.refTemp += (refSteady - led.refTemp) * alpha;
+	led.lastUpdate = now;
+}
+
+long LedContinuousCurrent(long LedType) {
+	switch (LedType) {
+	case ALP_HLD_PT120_RED: return 12000;
+	case ALP_HLD_PT120_RAX: case ALP_HLD_PT120_GREEN: case ALP_HLD_PT120_BLUE: case ALP_HLD_PT120TE_BLUE: return 18000;
+	case ALP_HLD_CBT90_UV: case ALP_HLD_CBT90_WHITE: return 13500;
+	case ALP_HLD_CBT120_UV: case ALP_HLD_CBM120_UV: return 18000;
+	case ALP_HLD_CBM120_UV365: case ALP_HLD_C_MULTI_405GR: return 12000;
+	case ALP_HLD_CBT140_WHITE: return 21000;
+	default: return 0;
+	}
+}
+
+// Projection start shared by AlpProjStart and AlpProjStartCont
+long StartProjection(ALP_ID DeviceId, ALP_ID SequenceId, bool continuous) {
+	std::unique_lock<std::mutex> lock(gMutex);
+	EmuSequence* seq = FindSequence(DeviceId, SequenceId);
+	if (seq == nullptr)
+		return ALP_NOT_AVAILABLE;
+	if (seq->firstFrame > seq->lastFrame)
+		return ALP_PARM_INVALID;
+	long long firstRow = 0;
+	long frames = seq->lastFrame - seq->firstFrame + 1;
+	if (seq->lineInc != 0 && !ScrollRange(*seq, firstRow, frames))
+		return ALP_PARM_INVALID;
+
+	long long const now = Now();
+	AdvanceProjection(now);
+
+	if (gDev.queueMode == ALP_PROJ_LEGACY) {
+		// One waiting position: replace it, and let an indefinite sequence finish its current iteration
+		gDev.waiting.clear();
+		if (gDev.hasActive && gDev.active.total == kInfinite)
+			CutActiveRun(now, false);
+	}
+	else if ((long)gDev.waiting.size() >= gConfig.QueueLength)
+		return ALP_NOT_READY;
+
+	EmuRun run = {};
+	run.sequenceId = SequenceId;
+	run.queueId = gDev.nextQueueId++;
+	run.enqueued = now;
+	run.pictureTime = seq->pictureTime * 1000LL;
+	run.illuminateTime = seq->illuminateTime * 1000LL;
+	run.firstFrame = seq->firstFrame;
+	run.frames = frames;
+	run.firstRow = firstRow;
+	run.lineInc = seq->lineInc;
+	run.total = continuous ? kInfinite : (long long)run.frames * seq->repeat;
+	run.slave = gDev.projMode == ALP_SLAVE;
+	run.triggered = run.slave || gDev.projStep != ALP_DEFAULT;
+	run.triggerInDelay = seq->triggerInDelay * 1000LL;
+	run.pendingSwitch = kNoSwitch;
+	gDev.waiting.push_back(run);
+	gDev.lastQueueId = run.queueId;
+	AdvanceProjection(now);
+
+	if (gDev.projSync == ALP_SYNCHRONOUS && !continuous) {
+		unsigned long const haltCount = gDev.haltCount;
+		while (SequenceInUse(SequenceId) && gDev.haltCount == haltCount) {
+			long long const wake = gDev.hasActive && RunEnd(gDev.active) != kInfinite ? RunEnd(gDev.active) : Now() + 1000000;
+			lock.unlock();
+			SleepUntil(wake);
+			lock.lock();
+			AdvanceProjection(Now());
+		}
+	}
+	return ALP_OK;
+}
+
+// Shared by AlpSeqPut and AlpSeqPutEx: transfers `lineLoad` rows of `picLoad` pictures
+long PutLines(ALP_ID DeviceId, ALP_ID SequenceId, long PicOffset, long PicLoad,
+	long LineOffset, long LineLoad, void* UserArrayPtr) {
+	std::unique_lock<std::mutex> lock(gMutex);
+	EmuSequence* seq = FindSequence(DeviceId, SequenceId);
+	if (seq == nullptr)
+		return ALP_NOT_AVAILABLE;
+	if (UserArrayPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	if (PicLoad == ALP_DEFAULT)
+		PicLoad = seq->picNum - PicOffset;
+	long const rows = DisplayRows(*seq);
+	if (LineLoad == ALP_DEFAULT)
+		LineLoad = rows - LineOffset;
+	if (PicOffset < 0 || PicLoad <= 0 || PicOffset + PicLoad > seq->picNum ||
+		LineOffset < 0 || LineLoad <= 0 || LineOffset + LineLoad > rows)
+		return ALP_PARM_INVALID;
+
+	long long const now = Now();
+	AdvanceProjection(now);
+	if (seq->putLock == ALP_DEFAULT && SequenceInUse(SequenceId))
+		return ALP_SEQ_IN_USE;
+
+	size_t const rowBytes = RowBytes(*seq);
+	size_t const pictureBytes = rowBytes * rows;
+	size_t const lineBytes = rowBytes * LineLoad;
+	size_t const bytes = lineBytes * PicLoad;
+
+	// The bus transfers one AlpSeqPut at a time
+	long long const start = std::max(now, gDev.usbFreeAt);
+	long long const duration = (long long)(gConfig.UsbLatency * 1000. + bytes / gConfig.UsbBandwidth * 1e9);
+	gDev.usbFreeAt = start + duration;
+	long long const done = gDev.usbFreeAt;
+	unsigned long const haltCount = gDev.haltCount;
+
+	char unsigned* target = nullptr;
+	if (gConfig.RetainImageData) {
+		seq->data.resize(pictureBytes * seq->picNum);
+		target = seq->data.data();
+	}
+	seq->putsInProgress++;
+	lock.unlock();
+
+	// Read the user buffer like the driver's DMA would; this also faults in mapped pages
+	char unsigned const* source = (char unsigned const*)UserArrayPtr;
+	volatile char unsigned sink = 0;
+	for (long pic = 0; pic < PicLoad; pic++) {
+		char unsigned const* picSource = source + lineBytes * pic;
+		if (target != nullptr)
+			memcpy(target + pictureBytes * (PicOffset + pic) + rowBytes * LineOffset, picSource, lineBytes);
+		else
+			for (size_t offset = 0; offset < lineBytes; offset += 4096)
+				sink = sink + picSource[offset];
+	}
+	SleepUntil(done);
+
+	lock.lock();
+	seq->putsInProgress--;
+	gUsbStats.Bytes += bytes;
+	gUsbStats.Transfers++;
+	gUsbStats.BusyTime += duration / 1e9;
+	return gDev.haltCount == haltCount ? ALP_OK : ALP_HALTED;
+}
+
+}
+
+tAlpEmuConfig AlpEmuDefaultConfig() {
+	tAlpEmuConfig config;
+	config.DmdType = ALP_DMDTYPE_XGA_07A;
+	config.AvailMemory = 87381;				// 64 GBit of XGA pictures
+	config.UsbBandwidth = 40e6;				// USB 2.0 Hi-Speed
+	config.UsbLatency = 100.;
+	config.RowLoadTime = 57.3;				// 22.7 kHz binary frame rate on XGA
+	config.MinLsbTime = 12.;
+	config.QueueLength = 32;
+	config.AmbientTemperature = 25.;
+	config.ThermalResistance = 0.85;
+	config.ThermalTimeConstant = 4.;
+	config.LedForwardVoltage = 4.;
+	config.TriggerLatency = 2.;
+	config.MaxFrameLog = 1 << 20;
+	config.RetainImageData = false;
+	return config;
+}
+
+long AlpEmuConfigure(const tAlpEmuConfig& config) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	long width, height;
+	if (gDev.allocated)
+		return ALP_NOT_IDLE;
+	if (!DmdSize(config.DmdType, width, height) || config.UsbBandwidth <= 0 || config.QueueLength <= 0 ||
+		config.ThermalTimeConstant <= 0 || config.TriggerLatency < 0)
+		return ALP_PARM_INVALID;
+	gConfig = config;
+	return ALP_OK;
+}
+
+unsigned long long AlpEmuFrameLog(std::vector<tAlpEmuFrameEvent>& events, bool clear) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (gDev.allocated)
+		AdvanceProjection(Now());
+	events = gFrameLog;
+	unsigned long long const dropped = gDroppedFrames;
+	if (clear) {
+		gFrameLog.clear();
+		gDroppedFrames = 0;
+	}
+	return dropped;
+}
+
+long AlpEmuTimingReport(ALP_ID SequenceId, tAlpEmuTimingReport& report) {
+	std::vector<tAlpEmuFrameEvent> events;
+	AlpEmuFrameLog(events);
+
+	report = tAlpEmuTimingReport();
+	report.MinPictureTime = 1e300;
+	double total = 0.;
+	for (size_t i = 1; i < events.size(); i++) {
+		tAlpEmuFrameEvent const& previous = events[i - 1];
+		if (events[i].Restart || (SequenceId != ALP_INVALID_ID && previous.SequenceId != SequenceId))
+			continue;
+		double const interval = (events[i].Time - previous.Time) / 1000.;
+		report.Frames++;
+		report.RequestedPictureTime = previous.PictureTime;
+		total += interval;
+		report.MinPictureTime = std::min(report.MinPictureTime, interval);
+		report.MaxPictureTime = std::max(report.MaxPictureTime, interval);
+		if (interval > previous.PictureTime) {
+			report.Gaps++;
+			report.GapTime += interval - previous.PictureTime;
+		}
+	}
+	if (report.Frames == 0) {
+		report.MinPictureTime = 0.;
+		return ALP_NOT_READY;
+	}
+	report.MeanPictureTime = total / report.Frames;
+	return ALP_OK;
+}
+
+void AlpEmuUsbStats(tAlpEmuUsbStats& stats) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	stats = gUsbStats;
+}
+
+long AlpEmuTrigger(ALP_ID DeviceId) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	long long const now = Now();
+	AdvanceProjection(now);
+	gTriggerStats.Triggers++;
+	if (!gDev.hasActive || !gDev.active.triggered || gDev.active.pendingSwitch != kNoSwitch) {
+		gTriggerStats.Missed++;
+		return ALP_OK;
+	}
+
+	// the current frame is shown for at least its picture time
+	EmuRun& run = gDev.active;
+	long long at = now + (long long)(gConfig.TriggerLatency * 1000.) + run.triggerInDelay;
+	if (run.shown > 0)
+		at = std::max(at, run.frameStart + run.pictureTime);
+	run.pendingSwitch = at;
+	gTriggerLatencySum += at - now;
+	gTriggerStats.MaxLatency = std::max(gTriggerStats.MaxLatency, (at - now) / 1000.);
+	unsigned long long const accepted = gTriggerStats.Triggers - gTriggerStats.Missed;
+	gTriggerStats.MeanLatency = gTriggerLatencySum / 1000. / accepted;
+	return ALP_OK;
+}
+
+void AlpEmuTriggerStats(tAlpEmuTriggerStats& stats) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	stats = gTriggerStats;
+}
+
+const char unsigned* AlpEmuSeqData(ALP_ID DeviceId, ALP_ID SequenceId) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	EmuSequence* seq = FindSequence(DeviceId, SequenceId);
+	return seq == nullptr || seq->data.empty() ? nullptr : seq->data.data();
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+
+long AlpDevAlloc(long DeviceNum, long /*InitFlag*/, ALP_ID* DeviceIdPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (DeviceIdPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	*DeviceIdPtr = ALP_INVALID_ID;
+	if (DeviceNum != ALP_DEFAULT)
+		return ALP_NOT_ONLINE;
+	if (gDev.allocated)
+		return ALP_NOT_READY;
+
+	ALP_ID const id = gDev.id + 1;
+	gDev = EmuDevice();
+	gDev.allocated = true;
+	gDev.id = id;
+	gDev.dmdType = gConfig.DmdType;
+	DmdSize(gDev.dmdType, gDev.width, gDev.height);
+	gDev.epoch = Clock::now();
+	gDev.nextSequenceId = 1;
+	gDev.projMode = ALP_MASTER;
+	gDev.projSync = ALP_ASYNCHRONOUS;
+	gDev.queueMode = ALP_PROJ_LEGACY;
+	gDev.projStep = ALP_DEFAULT;
+	gDev.idleSince = -1;
+	gDev.nextQueueId = 1;
+	gDev.lastQueueId = ALP_INVALID_ID;
+	gDev.nextLedId = 1;
+	gFrameLog.clear();
+	gDroppedFrames = 0;
+	gUsbStats = tAlpEmuUsbStats();
+	gTriggerStats = tAlpEmuTriggerStats();
+	gTriggerLatencySum = 0;
+
+	*DeviceIdPtr = id;
+	return ALP_OK;
+}
+
+long AlpDevHalt(ALP_ID DeviceId) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	HaltProjection(Now());
+	return ALP_OK;
+}
+
+long AlpDevFree(ALP_ID DeviceId) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	HaltProjection(Now());
+	for (auto const& entry : gDev.sequences)
+		if (entry.second.putsInProgress > 0)
+			return ALP_NOT_IDLE;
+	gDev.sequences.clear();
+	gDev.leds.clear();
+	gDev.allocated = false;
+	return ALP_OK;
+}
+
+long AlpDevControl(ALP_ID DeviceId, long ControlType, long ControlValue) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	switch (ControlType) {
+	case ALP_DEV_DMDTYPE: {
+		long width, height;
+		if (!gDev.sequences.empty())
+			return ALP_NOT_IDLE;
+		if (!DmdSize(ControlValue, width, height))
+			return ALP_PARM_INVALID;
+		gDev.dmdType = ControlValue; gDev.width = width; gDev.height = height;
+		return ALP_OK;
+	}
+	case ALP_SYNCH_POLARITY:
+		if (ControlValue != ALP_LEVEL_HIGH && ControlValue != ALP_LEVEL_LOW)
+			return ALP_PARM_INVALID;
+		break;
+	case ALP_TRIGGER_EDGE:
+		if (ControlValue != ALP_EDGE_FALLING && ControlValue != ALP_EDGE_RISING)
+			return ALP_PARM_INVALID;
+		break;
+	case ALP_TRIGGER_TIME_OUT: case ALP_USB_CONNECTION: case ALP_USB_DISCONNECT_BEHAVIOUR:
+	case ALP_DEV_DMD_MODE: case ALP_PWM_LEVEL: case ALP_DEV_DYN_SYNCH_OUT_WATCHDOG:
+		break;
+	default:
+		return ALP_PARM_INVALID;
+	}
+	gDev.controls[ControlType] = ControlValue;
+	return ALP_OK;
+}
+
+long AlpDevControlEx(ALP_ID DeviceId, long ControlType, void* UserStructPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	if (UserStructPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	switch (ControlType) {
+	case ALP_DEV_DYN_SYNCH_OUT1_GATE: case ALP_DEV_DYN_SYNCH_OUT2_GATE: case ALP_DEV_DYN_SYNCH_OUT3_GATE: {
+		tAlpDynSynchOutGate const& gate = *(tAlpDynSynchOutGate const*)UserStructPtr;
+		if (gate.Period > 16 || gate.Polarity > 1)
+			return ALP_PARM_INVALID;
+		gDev.synchGates[ControlType] = gate;
+		return ALP_OK;
+	}
+	default:
+		return ALP_PARM_INVALID;
+	}
+}
+
+long AlpDevInquire(ALP_ID DeviceId, long InquireType, long* UserVarPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	if (UserVarPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	AdvanceProjection(Now());
+	bool busy = gDev.hasActive || !gDev.waiting.empty();
+	for (auto const& entry : gDev.sequences)
+		busy = busy || entry.second.putsInProgress > 0;
+
+	switch (InquireType) {
+	case ALP_DEVICE_NUMBER: *UserVarPtr = 4242; break;
+	case ALP_VERSION: *UserVarPtr = 0x0402; break;
+	case ALP_DEV_STATE: *UserVarPtr = busy ? ALP_DEV_BUSY : ALP_DEV_IDLE; break;
+	case ALP_AVAIL_MEMORY: *UserVarPtr = gConfig.AvailMemory - gDev.usedMemory; break;
+	case ALP_DEV_DMDTYPE: *UserVarPtr = gDev.dmdType; break;
+	case ALP_DEV_DISPLAY_WIDTH: *UserVarPtr = gDev.width; break;
+	case ALP_DEV_DISPLAY_HEIGHT: *UserVarPtr = gDev.height; break;
+	case ALP_DDC_FPGA_TEMPERATURE: case ALP_APPS_FPGA_TEMPERATURE: *UserVarPtr = 45 * 256; break;
+	case ALP_PCB_TEMPERATURE: *UserVarPtr = 35 * 256; break;
+	case ALP_USB_CONNECTION: *UserVarPtr = ALP_OK; break;
+	default: {
+		auto it = gDev.controls.find(InquireType);
+		if (it == gDev.controls.end())
+			return ALP_PARM_INVALID;
+		*UserVarPtr = it->second;
+	}
+	}
+	return ALP_OK;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+
+long AlpSeqAlloc(ALP_ID DeviceId, long BitPlanes, long PicNum, ALP_ID* SequenceIdPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (SequenceIdPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	*SequenceIdPtr = ALP_INVALID_ID;
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	if (BitPlanes < 1 || BitPlanes > 8 || PicNum < 1)
+		return ALP_PARM_INVALID;
+	if ((long long)BitPlanes * PicNum > gConfig.AvailMemory - gDev.usedMemory)
+		return ALP_MEMORY_FULL;
+
+	EmuSequence seq = {};
+	seq.bitPlanes = BitPlanes;
+	seq.picNum = PicNum;
+	seq.bitNum = BitPlanes;
+	seq.binMode = ALP_BIN_NORMAL;
+	seq.dataFormat = ALP_DATA_MSB_ALIGN;
+	seq.lastFrame = PicNum - 1;
+	seq.aoiRows = gDev.height;
+	seq.repeat = 1;
+	seq.putLock = ALP_DEFAULT;
+	seq.pictureTime = std::max(kDefaultPictureTime, MinPictureTime(seq));
+	seq.illuminateTime = seq.pictureTime - DarkPhase(seq);
+
+	gDev.usedMemory += BitPlanes * PicNum;
+	*SequenceIdPtr = gDev.nextSequenceId++;
+	gDev.sequences[*SequenceIdPtr] = seq;
+	return ALP_OK;
+}
+
+long AlpSeqFree(ALP_ID DeviceId, ALP_ID SequenceId) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	EmuSequence* seq = FindSequence(DeviceId, SequenceId);
+	if (seq == nullptr)
+		return ALP_NOT_AVAILABLE;
+	AdvanceProjection(Now());
+	if (SequenceInUse(SequenceId) || seq->putsInProgress > 0)
+		return ALP_SEQ_IN_USE;
+	gDev.usedMemory -= seq->bitPlanes * seq->picNum;
+	gDev.sequences.erase(SequenceId);
+	return ALP_OK;
+}
+
+long AlpSeqControl(ALP_ID DeviceId, ALP_ID SequenceId, long ControlType, long ControlValue) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	EmuSequence* seq = FindSequence(DeviceId, SequenceId);
+	if (seq == nullptr)
+		return ALP_NOT_AVAILABLE;
+	switch (ControlType) {
+	case ALP_SEQ_REPEAT:
+		if (ControlValue < 1)
+			return ALP_PARM_INVALID;
+		seq->repeat = ControlValue;
+		break;
+	case ALP_FIRSTFRAME:
+		if (ControlValue < 0 || ControlValue >= seq->picNum)
+			return ALP_PARM_INVALID;
+		seq->firstFrame = ControlValue;
+		break;
+	case ALP_LASTFRAME:
+		if (ControlValue < 0 || ControlValue >= seq->picNum)
+			return ALP_PARM_INVALID;
+		seq->lastFrame = ControlValue;
+		break;
+	case ALP_FIRSTLINE:
+		if (ControlValue < 0 || ControlValue >= gDev.height)
+			return ALP_PARM_INVALID;
+		seq->firstLine = ControlValue;
+		break;
+	case ALP_LASTLINE:
+		if (ControlValue < 0 || ControlValue >= gDev.height)
+			return ALP_PARM_INVALID;
+		seq->lastLine = ControlValue;
+		break;
+	case ALP_SCROLL_FROM_ROW:
+		if (ControlValue < 0 || ControlValue >= seq->picNum * gDev.height)
+			return ALP_PARM_INVALID;
+		seq->firstFrame = ControlValue / gDev.height;
+		seq->firstLine = ControlValue % gDev.height;
+		break;
+	case ALP_SCROLL_TO_ROW:
+		if (ControlValue < 0 || ControlValue >= seq->picNum * gDev.height)
+			return ALP_PARM_INVALID;
+		seq->lastFrame = ControlValue / gDev.height;
+		seq->lastLine = ControlValue % gDev.height;
+		break;
+	case ALP_LINE_INC:
+		if (ControlValue < 0 || ControlValue > gDev.height)
+			return ALP_PARM_INVALID;
+		seq->lineInc = ControlValue;
+		break;
+	case ALP_BITNUM:
+		if (ControlValue < 1 || ControlValue > seq->bitPlanes)
+			return ALP_PARM_INVALID;
+		seq->bitNum = ControlValue;
+		break;
+	case ALP_BIN_MODE:
+		if (ControlValue != ALP_BIN_NORMAL && ControlValue != ALP_BIN_UNINTERRUPTED)
+			return ALP_PARM_INVALID;
+		seq->binMode = ControlValue;
+		break;
+	case ALP_DATA_FORMAT:
+		if (ControlValue < ALP_DATA_MSB_ALIGN || ControlValue > ALP_DATA_BINARY_BOTTOMUP)
+			return ALP_PARM_INVALID;
+		if (ControlValue >= ALP_DATA_BINARY_TOPDOWN && seq->bitPlanes != 1)
+			return ALP_PARM_INVALID;
+		seq->dataFormat = ControlValue;
+		break;
+	case ALP_SEQ_PUT_LOCK:
+		seq->putLock = ControlValue;
+		break;
+	case ALP_SEQ_DMD_LINES: {
+		// changes the layout of the pictures, so previously uploaded data is discarded
+		long const startRow = ControlValue & 0xFFFF, rowCount = (ControlValue >> 16) & 0xFFFF;
+		if (rowCount < 1 || startRow + rowCount > gDev.height)
+			return ALP_PARM_INVALID;
+		AdvanceProjection(Now());
+		if (SequenceInUse(SequenceId) || seq->putsInProgress > 0)
+			return ALP_SEQ_IN_USE;
+		seq->aoiStart = startRow;
+		seq->aoiRows = rowCount;
+		seq->data.clear();
+		break;
+	}
+	case ALP_PWM_MODE: case ALP_FLUT_MODE: case ALP_FLUT_ENTRIES9: case ALP_FLUT_OFFSET9:
+	case ALP_X_SHEAR_SELECT: case ALP_DMD_MASK_SELECT:
+		seq->controls[ControlType] = ControlValue;
+		break;
+	default:
+		return ALP_PARM_INVALID;
+	}
+	// Keep the timing valid for settings that raise the minimum picture time
+	seq->pictureTime = std::max(seq->pictureTime, MinPictureTime(*seq));
+	seq->illuminateTime = std::min(seq->illuminateTime, seq->pictureTime - DarkPhase(*seq));
+	return ALP_OK;
+}
+
+long AlpSeqTiming(ALP_ID DeviceId, ALP_ID SequenceId, long IlluminateTime,
+	long PictureTime, long SynchDelay, long SynchPulseWidth, long TriggerInDelay) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	EmuSequence* seq = FindSequence(DeviceId, SequenceId);
+	if (seq == nullptr)
+		return ALP_NOT_AVAILABLE;
+	long const darkPhase = DarkPhase(*seq);
+
+	if (PictureTime == ALP_DEFAULT)
+		PictureTime = IlluminateTime == ALP_DEFAULT
+			? std::max(kDefaultPictureTime, MinPictureTime(*seq)) : IlluminateTime + darkPhase;
+	if (IlluminateTime == ALP_DEFAULT)
+		IlluminateTime = PictureTime - darkPhase;
+
+	if (PictureTime < MinPictureTime(*seq) || PictureTime > kMaxPictureTime ||
+		IlluminateTime < MinIlluminateTime(*seq) || IlluminateTime > PictureTime - darkPhase ||
+		SynchDelay < 0 || SynchDelay > kMaxSynchDelay || SynchPulseWidth < 0 ||
+		TriggerInDelay < 0 || TriggerInDelay > kMaxTriggerInDelay)
+		return ALP_PARM_INVALID;
+
+	seq->illuminateTime = IlluminateTime;
+	seq->pictureTime = PictureTime;
+	seq->synchDelay = SynchDelay;
+	seq->synchPulseWidth = SynchPulseWidth;
+	seq->triggerInDelay = TriggerInDelay;
+	return ALP_OK;
+}
+
+long AlpSeqInquire(ALP_ID DeviceId, ALP_ID SequenceId, long InquireType, long* UserVarPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	EmuSequence* seq = FindSequence(DeviceId, SequenceId);
+	if (seq == nullptr)
+		return ALP_NOT_AVAILABLE;
+	if (UserVarPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	switch (InquireType) {
+	case ALP_BITPLANES: *UserVarPtr = seq->bitPlanes; break;
+	case ALP_PICNUM: *UserVarPtr = seq->picNum; break;
+	case ALP_PICTURE_TIME: *UserVarPtr = seq->pictureTime; break;
+	case ALP_ILLUMINATE_TIME: *UserVarPtr = seq->illuminateTime; break;
+	case ALP_SYNCH_DELAY: *UserVarPtr = seq->synchDelay; break;
+	case ALP_SYNCH_PULSEWIDTH: *UserVarPtr = seq->synchPulseWidth; break;
+	case ALP_TRIGGER_IN_DELAY: *UserVarPtr = seq->triggerInDelay; break;
+	case ALP_MAX_SYNCH_DELAY: *UserVarPtr = kMaxSynchDelay; break;
+	case ALP_MAX_TRIGGER_IN_DELAY: *UserVarPtr = kMaxTriggerInDelay; break;
+	case ALP_MIN_PICTURE_TIME: *UserVarPtr = MinPictureTime(*seq); break;
+	case ALP_MIN_ILLUMINATE_TIME: *UserVarPtr = MinIlluminateTime(*seq); break;
+	case ALP_MAX_PICTURE_TIME: *UserVarPtr = kMaxPictureTime; break;
+	case ALP_ON_TIME: *UserVarPtr = seq->illuminateTime; break;
+	case ALP_OFF_TIME: *UserVarPtr = seq->pictureTime - seq->illuminateTime; break;
+	case ALP_SEQ_REPEAT: *UserVarPtr = seq->repeat; break;
+	case ALP_FIRSTFRAME: *UserVarPtr = seq->firstFrame; break;
+	case ALP_LASTFRAME: *UserVarPtr = seq->lastFrame; break;
+	case ALP_FIRSTLINE: *UserVarPtr = seq->firstLine; break;
+	case ALP_LASTLINE: *UserVarPtr = seq->lastLine; break;
+	case ALP_LINE_INC: *UserVarPtr = seq->lineInc; break;
+	case ALP_SCROLL_FROM_ROW: *UserVarPtr = seq->firstFrame * gDev.height + seq->firstLine; break;
+	case ALP_SCROLL_TO_ROW: *UserVarPtr = seq->lastFrame * gDev.height + seq->lastLine; break;
+	case ALP_BITNUM: *UserVarPtr = seq->bitNum; break;
+	case ALP_BIN_MODE: *UserVarPtr = seq->binMode; break;
+	case ALP_DATA_FORMAT: *UserVarPtr = seq->dataFormat; break;
+	case ALP_SEQ_PUT_LOCK: *UserVarPtr = seq->putLock; break;
+	case ALP_SEQ_DMD_LINES: *UserVarPtr = MAKELONG(seq->aoiStart, seq->aoiRows); break;
+	default: {
+		auto it = seq->controls.find(InquireType);
+		if (it == seq->controls.end())
+			return ALP_PARM_INVALID;
+		*UserVarPtr = it->second;
+	}
+	}
+	return ALP_OK;
+}
+
+long AlpSeqPut(ALP_ID DeviceId, ALP_ID SequenceId, long PicOffset, long PicLoad, void* UserArrayPtr) {
+	return PutLines(DeviceId, SequenceId, PicOffset, PicLoad, 0, ALP_DEFAULT, UserArrayPtr);
+}
+
+long AlpSeqPutEx(ALP_ID DeviceId, ALP_ID SequenceId, void* UserStructPtr, void* UserArrayPtr) {
+	if (UserStructPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	tAlpLinePut const& linePut = *(tAlpLinePut const*)UserStructPtr;
+	if (linePut.TransferMode != ALP_PUT_LINES)
+		return ALP_PARM_INVALID;
+	return PutLines(DeviceId, SequenceId, linePut.PicOffset, linePut.PicLoad,
+		linePut.LineOffset, linePut.LineLoad, UserArrayPtr);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+
+long AlpProjStart(ALP_ID DeviceId, ALP_ID SequenceId) {
+	return StartProjection(DeviceId, SequenceId, false);
+}
+
+long AlpProjStartCont(ALP_ID DeviceId, ALP_ID SequenceId) {
+	return StartProjection(DeviceId, SequenceId, true);
+}
+
+long AlpProjHalt(ALP_ID DeviceId) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	HaltProjection(Now());
+	return ALP_OK;
+}
+
+long AlpProjWait(ALP_ID DeviceId) {
+	std::unique_lock<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	unsigned long const haltCount = gDev.haltCount;
+	for (;;) {
+		AdvanceProjection(Now());
+		if (gDev.haltCount != haltCount || (!gDev.hasActive && gDev.waiting.empty()))
+			return ALP_OK;
+		if (gDev.active.total == kInfinite)
+			return ALP_NOT_READY;
+		for (auto const& run : gDev.waiting)
+			if (run.total == kInfinite)
+				return ALP_NOT_READY;
+		long long const wake = gDev.hasActive && RunEnd(gDev.active) != kInfinite ? RunEnd(gDev.active) : Now() + 1000000;
+		lock.unlock();
+		SleepUntil(wake);
+		lock.lock();
+		if (!ValidDevice(DeviceId))
+			return ALP_NOT_AVAILABLE;
+	}
+}
+
+long AlpProjControl(ALP_ID DeviceId, long ControlType, long ControlValue) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	long long const now = Now();
+	AdvanceProjection(now);
+	switch (ControlType) {
+	// both apply to runs started afterwards
+	case ALP_PROJ_MODE:
+		if (ControlValue != ALP_MASTER && ControlValue != ALP_SLAVE)
+			return ALP_PARM_INVALID;
+		gDev.projMode = ControlValue;
+		return ALP_OK;
+	case ALP_PROJ_STEP:
+		if (ControlValue != ALP_DEFAULT && ControlValue != ALP_LEVEL_HIGH && ControlValue != ALP_LEVEL_LOW &&
+			ControlValue != ALP_EDGE_RISING && ControlValue != ALP_EDGE_FALLING)
+			return ALP_PARM_INVALID;
+		gDev.projStep = ControlValue;
+		// a stored edge is discarded
+		if (gDev.hasActive && gDev.active.triggered && gDev.active.shown > 0)
+			gDev.active.pendingSwitch = kNoSwitch;
+		return ALP_OK;
+	case ALP_PROJ_SYNC:
+		if (ControlValue != ALP_SYNCHRONOUS && ControlValue != ALP_ASYNCHRONOUS)
+			return ALP_PARM_INVALID;
+		gDev.projSync = ControlValue;
+		return ALP_OK;
+	case ALP_PROJ_QUEUE_MODE:
+		if (ControlValue != ALP_PROJ_LEGACY && ControlValue != ALP_PROJ_SEQUENCE_QUEUE)
+			return ALP_PARM_INVALID;
+		if (gDev.hasActive || !gDev.waiting.empty())
+			return ALP_NOT_IDLE;
+		gDev.queueMode = ControlValue;
+		return ALP_OK;
+	case ALP_PROJ_RESET_QUEUE:
+		gDev.waiting.clear();
+		return ALP_OK;
+	case ALP_PROJ_ABORT_SEQUENCE: case ALP_PROJ_ABORT_FRAME: {
+		bool const afterFrame = ControlType == ALP_PROJ_ABORT_FRAME;
+		if (ControlValue == ALP_DEFAULT || (gDev.hasActive && (ALP_ID)ControlValue == gDev.active.queueId)) {
+			if (gDev.hasActive)
+				CutActiveRun(now, afterFrame);
+			return ALP_OK;
+		}
+		for (auto it = gDev.waiting.begin(); it != gDev.waiting.end(); ++it)
+			if (it->queueId == (ALP_ID)ControlValue) {
+				if (gDev.hasActive && gDev.active.total == kInfinite)
+					return ALP_PARM_INVALID;	// would wait forever behind AlpProjStartCont
+				it->total = afterFrame ? 1 : it->frames;
+				return ALP_OK;
+			}
+		return ALP_PARM_INVALID;
+	}
+	case ALP_PROJ_INVERSION: case ALP_PROJ_UPSIDE_DOWN: case ALP_PROJ_LEFT_RIGHT_FLIP:
+	case ALP_PROJ_WAIT_UNTIL:
+		gDev.projControls[ControlType] = ControlValue;
+		return ALP_OK;
+	default:
+		return ALP_PARM_INVALID;
+	}
+}
+
+long AlpProjControlEx(ALP_ID DeviceId, long ControlType, void* pUserStructPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	if (pUserStructPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	switch (ControlType) {
+	case ALP_FLUT_WRITE_9BIT: case ALP_FLUT_WRITE_18BIT: case ALP_X_SHEAR: case ALP_DMD_MASK_WRITE:
+		return ALP_OK;	// accepted, but without effect on the model
+	default:
+		return ALP_PARM_INVALID;
+	}
+}
+
+long AlpProjInquire(ALP_ID DeviceId, long InquireType, long* UserVarPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	if (UserVarPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	AdvanceProjection(Now());
+	switch (InquireType) {
+	case ALP_PROJ_MODE: *UserVarPtr = gDev.projMode; break;
+	case ALP_PROJ_SYNC: *UserVarPtr = gDev.projSync; break;
+	case ALP_PROJ_STEP: *UserVarPtr = gDev.projStep; break;
+	case ALP_PROJ_STATE: *UserVarPtr = gDev.hasActive ? ALP_PROJ_ACTIVE : ALP_PROJ_IDLE; break;
+	case ALP_PROJ_QUEUE_MODE: *UserVarPtr = gDev.queueMode; break;
+	case ALP_PROJ_QUEUE_ID: *UserVarPtr = (long)gDev.lastQueueId; break;
+	case ALP_PROJ_QUEUE_MAX_AVAIL: *UserVarPtr = gConfig.QueueLength; break;
+	case ALP_PROJ_QUEUE_AVAIL: *UserVarPtr = gConfig.QueueLength - (long)gDev.waiting.size(); break;
+	default: {
+		auto it = gDev.projControls.find(InquireType);
+		if (it == gDev.projControls.end())
+			return ALP_PARM_INVALID;
+		*UserVarPtr = it->second;
+	}
+	}
+	return ALP_OK;
+}
+
+long AlpProjInquireEx(ALP_ID DeviceId, long InquireType, void* UserStructPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	if (UserStructPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	if (InquireType != ALP_PROJ_PROGRESS)
+		return ALP_PARM_INVALID;
+
+	long long const now = Now();
+	AdvanceProjection(now);
+	tAlpProjProgress& progress = *(tAlpProjProgress*)UserStructPtr;
+	memset(&progress, 0, sizeof(progress));
+	progress.nWaitingSequences = (unsigned long)gDev.waiting.size();
+	if (!gDev.hasActive) {
+		progress.CurrentQueueId = ALP_INVALID_ID;
+		progress.SequenceId = ALP_INVALID_ID;
+		progress.nFlags = ALP_FLAG_QUEUE_IDLE;
+		return ALP_OK;
+	}
+
+	EmuRun const& run = gDev.active;
+	long long const current = CurrentFrame(run, now);
+	progress.CurrentQueueId = run.queueId;
+	progress.SequenceId = run.sequenceId;
+	progress.nPictureTime = (unsigned long)(run.pictureTime / 1000);
+	progress.nFramesPerSubSequence = run.frames;
+	progress.nFrameCounter = (unsigned long)(run.frames - current % run.frames);
+	if (run.total == kInfinite) {
+		progress.nSequenceCounter = ULONG_MAX - (unsigned long)(current / run.frames);
+		progress.nFlags |= ALP_FLAG_SEQUENCE_INDEFINITE;
+	}
+	else {
+		progress.nSequenceCounter = (unsigned long)((run.total - current + run.frames - 1) / run.frames);
+		long long const frameStart = run.triggered ? run.frameStart : run.start + current * run.pictureTime;
+		if (current == run.total - 1 && now - frameStart >= run.illuminateTime)
+			progress.nFlags |= ALP_FLAG_FRAME_FINISHED;
+	}
+	return ALP_OK;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+
+long AlpLedAlloc(ALP_ID DeviceId, long LedType, void* UserStructPtr, ALP_ID* LedId) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (LedId == nullptr)
+		return ALP_ADDR_INVALID;
+	*LedId = ALP_INVALID_ID;
+	if (!ValidDevice(DeviceId))
+		return ALP_NOT_AVAILABLE;
+	if (LedContinuousCurrent(LedType) == 0)
+		return ALP_PARM_INVALID;
+	if ((long)gDev.leds.size() >= kMaxLeds)
+		return ALP_NOT_READY;
+
+	long const index = (long)gDev.leds.size();
+	EmuLed led = {};
+	led.type = LedType;
+	led.contCurrent = LedContinuousCurrent(LedType);
+	led.setCurrent = led.contCurrent;
+	led.forceOff = ALP_LED_AUTO_OFF;
+	if (UserStructPtr != nullptr)
+		led.allocParams = *(tAlpHldAllocParams const*)UserStructPtr;
+	else {
+		led.allocParams.I2cDacAddr = 24 + 2 * index;
+		led.allocParams.I2cAdcAddr = 64 + 2 * index;
+	}
+	led.junctionTemp = led.refTemp = gConfig.AmbientTemperature;
+	led.lastUpdate = Now();
+
+	*LedId = gDev.nextLedId++;
+	gDev.leds[*LedId] = led;
+	return ALP_OK;
+}
+
+long AlpLedFree(ALP_ID DeviceId, ALP_ID LedId) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (FindLed(DeviceId, LedId) == nullptr)
+		return ALP_NOT_AVAILABLE;
+	gDev.leds.erase(LedId);
+	return ALP_OK;
+}
+
+long AlpLedControl(ALP_ID DeviceId, ALP_ID LedId, long ControlType, long Value) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	EmuLed* led = FindLed(DeviceId, LedId);
+	if (led == nullptr)
+		return ALP_NOT_AVAILABLE;
+	UpdateLedTemperature(*led, Now());
+	switch (ControlType) {
+	case ALP_LED_SET_CURRENT:
+		if (Value < 0 || Value > led->contCurrent)
+			return ALP_PARM_INVALID;
+		led->setCurrent = Value;
+		return ALP_OK;
+	case ALP_LED_BRIGHTNESS:
+		if (Value < 0 || Value > 133)
+			return ALP_PARM_INVALID;
+		led->brightness = Value;
+		return ALP_OK;
+	case ALP_LED_FORCE_OFF:
+		if (Value != ALP_LED_AUTO_OFF && Value != ALP_LED_OFF && Value != ALP_LED_ON)
+			return ALP_PARM_INVALID;
+		led->forceOff = Value;
+		return ALP_OK;
+	default:
+		return ALP_PARM_INVALID;
+	}
+}
+
+long AlpLedInquire(ALP_ID DeviceId, ALP_ID LedId, long InquireType, long* UserVarPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	EmuLed* led = FindLed(DeviceId, LedId);
+	if (led == nullptr)
+		return ALP_NOT_AVAILABLE;
+	if (UserVarPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	UpdateLedTemperature(*led, Now());
+	bool const on = led->forceOff != ALP_LED_OFF && led->brightness > 0;
+	switch (InquireType) {
+	case ALP_LED_SET_CURRENT: *UserVarPtr = led->setCurrent; break;
+	case ALP_LED_BRIGHTNESS: *UserVarPtr = led->brightness; break;
+	case ALP_LED_TYPE: *UserVarPtr = led->type; break;
+	case ALP_LED_MEASURED_CURRENT: *UserVarPtr = on ? led->setCurrent * led->brightness / 100 : 0; break;
+	case ALP_LED_TEMPERATURE_REF: *UserVarPtr = (long)std::lround(led->refTemp * 256.); break;
+	case ALP_LED_TEMPERATURE_JUNCTION: *UserVarPtr = (long)std::lround(led->junctionTemp * 256.); break;
+	default: return ALP_PARM_INVALID;
+	}
+	return ALP_OK;
+}
+
+long AlpLedControlEx(ALP_ID DeviceId, ALP_ID LedId, long /*ControlType*/, void* /*UserStructPtr*/) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	if (FindLed(DeviceId, LedId) == nullptr)
+		return ALP_NOT_AVAILABLE;
+	return ALP_PARM_INVALID;	// alp.h defines no ControlTypes for AlpLedControlEx
+}
+
+long AlpLedInquireEx(ALP_ID DeviceId, ALP_ID LedId, long InquireType, void* UserStructPtr) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	EmuLed* led = FindLed(DeviceId, LedId);
+	if (led == nullptr)
+		return ALP_NOT_AVAILABLE;
+	if (UserStructPtr == nullptr)
+		return ALP_ADDR_INVALID;
+	if (InquireType != ALP_LED_ALLOC_PARAMS)
+		return ALP_PARM_INVALID;
+	*(tAlpHldAllocParams*)UserStructPtr = led->allocParams;
+	return ALP_OK;
+}
+
+#endif
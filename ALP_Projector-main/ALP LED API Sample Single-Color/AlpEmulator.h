@@ -0,0 +1,127 @@
+#pragma once
+
+/**
+* @file AlpEmulator.h
+*
+* @brief In-process software model of an ALP V-Module, implementing the alp.h API.
+*
+* Building with ALP_EMULATOR defined (always the case outside of Windows) makes
+* AlpEmulator.cpp provide every AlpDev*, AlpSeq*, AlpProj* and AlpLed* entry point
+* instead of importing them from alpV42.dll, so Projector and AlpFrames run unchanged
+* on machines without a V-Module.
+*
+* The model covers:
+* - on-board sequence memory (ALP_AVAIL_MEMORY, ALP_MEMORY_FULL),
+* - USB upload bandwidth: AlpSeqPut blocks for as long as the transfer would take,
+* - picture-time scheduling of AlpProjStart/AlpProjStartCont, including the sequence queue,
+* - areas of interest (ALP_SEQ_DMD_LINES): pictures hold, upload and load only the selected
+*   rows, which lowers ALP_MIN_PICTURE_TIME,
+* - line scrolling (ALP_LINE_INC), where the pictures form one tall image shown through a moving window,
+* - triggered projection (ALP_SLAVE, ALP_PROJ_STEP) with a trigger input driven by AlpEmuTrigger,
+* - LED current and a first-order thermal model of the junction temperature.
+*
+* Every frame switch is recorded with a timestamp, which allows checking that the
+* requested picture time is actually achieved by the upload and display pipeline.
+* Projection is evaluated lazily from the device clock, so frame timestamps are exact
+* and only gaps caused by the host (e.g. a late AlpProjStart) show up in the log.
+*/
+
+#include "stdafx.h"
+#include "alp.h"
+#include <vector>
+
+#ifdef ALP_EMULATOR
+
+/**
+* @brief Emulated hardware parameters, applied at the next AlpDevAlloc.
+*/
+struct tAlpEmuConfig {
+	long DmdType;				/* ALP_DMDTYPE_*, selects the display width and height */
+	long AvailMemory;			/* on-board sequence memory [binary pictures] */
+	double UsbBandwidth;		/* sustained AlpSeqPut throughput [bytes/s] */
+	double UsbLatency;			/* fixed overhead of each AlpSeqPut [us] */
+	double RowLoadTime;			/* time to load one binary DMD row [ns], determines ALP_MIN_PICTURE_TIME */
+	double MinLsbTime;			/* shortest gray-scale bit-plane illumination [us] */
+	long QueueLength;			/* ALP_PROJ_QUEUE_MAX_AVAIL */
+	double AmbientTemperature;	/* [degC] */
+	double ThermalResistance;	/* LED junction to ambient [K/W] */
+	double ThermalTimeConstant;	/* [s] */
+	double LedForwardVoltage;	/* [V] */
+	double TriggerLatency;		/* trigger input to frame switch, besides ALP_TRIGGER_IN_DELAY [us] */
+	size_t MaxFrameLog;			/* frame switches recorded before the log stops growing */
+	bool RetainImageData;		/* keep a copy of all uploaded data, see AlpEmuSeqData */
+};
+
+/**
+* @brief One frame switch, i.e. the moment a picture starts to be displayed.
+*/
+struct tAlpEmuFrameEvent {
+	long long Time;				/* [ns] since AlpDevAlloc */
+	ALP_ID SequenceId;
+	ALP_ID QueueId;
+	long Frame;					/* picture number within the sequence */
+	long Line;					/* first row shown of that picture, 0 unless scrolling */
+	long PictureTime;			/* [us] the picture is shown for */
+	bool Restart;				/* first frame after AlpDevAlloc or a halt, i.e. not a frame switch */
+};
+
+/**
+* @brief Achieved picture timing, derived from the frame-switch log.
+*/
+struct tAlpEmuTimingReport {
+	unsigned long Frames;			/* frame switches evaluated */
+	double RequestedPictureTime;	/* [us], ALP_PICTURE_TIME of the (last) sequence */
+	double MeanPictureTime;			/* [us] */
+	double MinPictureTime;			/* [us] */
+	double MaxPictureTime;			/* [us] */
+	unsigned long Gaps;				/* frame switches later than the requested picture time */
+	double GapTime;					/* total delay of those frame switches [us] */
+};
+
+/**
+* @brief Accumulated USB transfer statistics.
+*/
+struct tAlpEmuUsbStats {
+	unsigned long long Bytes;
+	unsigned long long Transfers;
+	double BusyTime;				/* [s] the emulated bus spent transferring */
+};
+
+/**
+* @brief Trigger input statistics, see AlpEmuTrigger.
+*/
+struct tAlpEmuTriggerStats {
+	unsigned long long Triggers;	/* edges received */
+	unsigned long long Missed;		/* edges without effect: no triggered projection, or a frame switch still pending */
+	double MeanLatency;				/* [us] from the edge to the frame switch it caused */
+	double MaxLatency;				/* [us] */
+};
+
+// Default parameters: an XGA V-Module with USB 3 and a blue PT120 LED
+tAlpEmuConfig AlpEmuDefaultConfig();
+
+// Replace the emulated hardware parameters. Returns ALP_NOT_IDLE while a device is allocated.
+long AlpEmuConfigure(const tAlpEmuConfig& config);
+
+// Copy the recorded frame switches to `events`, optionally clearing the log.
+// Returns the number of frame switches that were dropped because the log was full.
+unsigned long long AlpEmuFrameLog(std::vector<tAlpEmuFrameEvent>& events, bool clear = false);
+
+// Evaluate the frame-switch log for one sequence, or for all sequences if SequenceId is ALP_INVALID_ID.
+long AlpEmuTimingReport(ALP_ID SequenceId, tAlpEmuTimingReport& report);
+
+void AlpEmuUsbStats(tAlpEmuUsbStats& stats);
+
+// One active edge at the trigger input, e.g. from a camera's exposure output. In ALP_SLAVE mode
+// it starts the next picture, with ALP_PROJ_STEP it ends the current one. The input sees pulses,
+// so level and edge conditions behave alike. An edge arriving before the current picture has
+// been shown for its picture time is stored, a second one is missed.
+long AlpEmuTrigger(ALP_ID DeviceId);
+
+void AlpEmuTriggerStats(tAlpEmuTriggerStats& stats);
+
+// Uploaded picture data of a sequence, or NULL unless tAlpEmuConfig::RetainImageData is set.
+// Pictures of an area of interest hold only its rows.
+const char unsigned* AlpEmuSeqData(ALP_ID DeviceId, ALP_ID SequenceId);
+
+#endif
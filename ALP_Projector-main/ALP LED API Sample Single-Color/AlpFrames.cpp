@@ -11,37 +11,61 @@
 
 #include "AlpFrames.h"
 #include "AlpUserInterface.h"
+#include "AlpPack.h"
+#include "AlpDisplayList.h"
+#include "AlpThreadPool.h"
+#include "AlpSequenceFile.h"
+#ifdef _WIN32
 #include <crtdbg.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <memory>
 #include <stdio.h>
 #include <typeinfo>
-#include "Windows.h"
 #include <stdexcept>
 #include <iostream>
 
+namespace {
+
+// Generation clock shared by all frames, see generationMark
+std::atomic<unsigned long long> gGeneration(1);
+
+}
+
 /**
 * @brief Constructor for the AlpFrames class
 * @param frames The number of frames in the image sequence
 * @param width The width of the image
 * @param height The height of the image
+* @param format Gray8 (one byte per pixel) or Binary (packed, 8 pixels per byte)
+* @param firstRow For frames of an area of interest (ALP_SEQ_DMD_LINES), the DMD row of their
+* first row; `height` is then the number of rows of the area. 0 for full frames.
 *
-* This constructor takes in three parameters, the number of frames, width and
-* height of the image to be projected. It also initializes the _frameCount,
-* _width, _height and _imageData. It uses `new` to allocate `frames * width
-* height` bytes of storage, hence, _imageData is a non-null pointer to the first
-* byte of the block.
+* This constructor takes in the number of frames, width and height of the image
+* to be projected, and the storage format. It also initializes the _frameCount,
+* _width, _height and _imageData. It uses `new` to allocate `frames * frameBytes()`
+* bytes of storage, hence, _imageData is a non-null pointer to the first byte of
+* the block. Binary frames need 8x less memory and upload 8x less data.
+* All frames count as modified now (see generation).
 *
 * @return Initializes the member variables with the given parameters
 *
 * @throws std::invalid_argument if width or height is less than or equal to zero
+* @throws std::invalid_argument if firstRow is negative
 * @throws std::invalid_argument if _imageData is null
 */
-AlpFrames::AlpFrames(const long frames, const long width, const long height)
-	: _frameCount(frames), _width(width), _height(height),
-	_imageData(new char unsigned[frames * width * height]) {
+AlpFrames::AlpFrames(const long frames, const long width, const long height, const PixelFormat format, const long firstRow)
+	: _frameCount(frames), _width(width), _height(height), _format(format),
+	_rowBytes(format == PixelFormat::Binary ? binaryRowBytes(width) : width), _firstRow(firstRow),
+	_ownsData(true), _imageData(new char unsigned[frames * frameBytes()]), _generations(frames) {
 	try {
 		if (_width <= 0 || _height <= 0)
 			throw std::invalid_argument("Error: Projector dimensions must be positive integers.");
+		if (_firstRow < 0)
+			throw std::invalid_argument("Error: `firstRow` must not be negative.");
 		if (_imageData == nullptr)
 			throw std::invalid_argument("Error: ImageData pointer can't be null.");
 	}
@@ -51,12 +75,43 @@ AlpFrames::AlpFrames(const long frames, const long width, const long height)
 		exit(1);
 	}
 
-	memset(_imageData, 0, frames * width * height);
+	memset(_imageData, 0, frames * frameBytes());
+	touch(0, frames);
+}
+
+/**
+* @brief Constructs frames on top of existing storage, without allocating or clearing it.
+*
+* @param imageData At least `frames * frameBytes()` bytes laid out as by the allocating constructor.
+* The storage must outlive the object and is not freed by it.
+*
+* Used to draw directly into buffers owned by someone else, e.g. the frame slots of AlpUploader.
+* Modifications are not tracked: the owner of the storage does (e.g. renderFrames for the
+* frame it hands to the generator), and generation always reports frames as just modified.
+*/
+AlpFrames::AlpFrames(char unsigned* imageData, const long frames, const long width, const long height, const PixelFormat format, const long firstRow)
+	: _frameCount(frames), _width(width), _height(height), _format(format),
+	_rowBytes(format == PixelFormat::Binary ? binaryRowBytes(width) : width), _firstRow(firstRow),
+	_ownsData(false), _imageData(imageData) {
+	try {
+		if (_width <= 0 || _height <= 0)
+			throw std::invalid_argument("Error: Projector dimensions must be positive integers.");
+		if (_firstRow < 0)
+			throw std::invalid_argument("Error: `firstRow` must not be negative.");
+		if (_imageData == nullptr)
+			throw std::invalid_argument("Error: ImageData pointer can't be null.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
 }
 
 AlpFrames::AlpFrames(const AlpFrames& a)
-	: _frameCount(a._frameCount), _width(a._width), _height(a._height),
-	_imageData(new char unsigned[a._frameCount * a._width * a._height]) {
+	: _frameCount(a._frameCount), _width(a._width), _height(a._height), _format(a._format),
+	_rowBytes(a._rowBytes), _firstRow(a._firstRow), _ownsData(true), _imageData(new char unsigned[a._frameCount * a.frameBytes()]),
+	_generations(a._frameCount) {
 	try {
 		if (_width <= 0 || _height <= 0)
 			throw std::invalid_argument("Error: Projector dimensions must be positive integers.");
@@ -69,30 +124,210 @@ AlpFrames::AlpFrames(const AlpFrames& a)
 		exit(1);
 	}
 
-	memset(_imageData, 0, a._frameCount * a._width * a._height);
+	memset(_imageData, 0, a._frameCount * a.frameBytes());
+	touch(0, _frameCount);
 }
 
 /**
  *  @brief Destructor for AlpFrames object
  *
  *  This destructor is responsible for cleaning up any resources that were
- *  allocated during the lifetime of the object. It resets image to all black
- *  to avoid heap errors.
+ *  allocated during the lifetime of the object.
  */
 AlpFrames::~AlpFrames(void) {
-	memset(_imageData, 0, _width * _height);
+	if (_ownsData)
+		delete[] _imageData;
+}
+
+/**
+* @brief Number of bytes one frame occupies in the current storage format.
+*/
+size_t AlpFrames::frameBytes() const {
+	return (size_t)_rowBytes * _height;
+}
+
+/**
+* @brief 64-bit hash of the dimensions, format, first row and all frame bytes.
+*
+* Mixes eight bytes per step, so hashing is much faster than uploading the frames.
+* Used to recognize frames that are already resident on the device (see Projector::cachedSequence).
+*/
+unsigned long long AlpFrames::contentHash() const {
+	unsigned long long const k1 = 0x9E3779B97F4A7C15ULL, k2 = 0xC2B2AE3D27D4EB4FULL;
+	auto const mix = [&](unsigned long long hash, unsigned long long word) {
+		hash ^= word * k1;
+		return ((hash << 31) | (hash >> 33)) * k2;
+	};
+
+	unsigned long long hash = mix(mix(mix(mix(0, (unsigned long long)_frameCount), (unsigned long long)_width),
+		(unsigned long long)_height * 2 + (_format == PixelFormat::Binary)), (unsigned long long)_firstRow);
+	size_t const bytes = _frameCount * frameBytes();
+	size_t i = 0;
+	for (; i + 8 <= bytes; i += 8) {
+		unsigned long long word;
+		memcpy(&word, _imageData + i, sizeof(word));
+		hash = mix(hash, word);
+	}
+	for (; i < bytes; i++)
+		hash = mix(hash, _imageData[i]);
+	hash ^= hash >> 29;
+	return hash * k1;
+}
+
+/**
+* @brief Writes the frames to a pre-packed sequence file (.alpseq), exactly as they are uploaded.
+*
+* @param bitPlanes ALP_BITPLANES of the sequence: 1 for Binary frames, 2 to 8 for Gray8 frames.
+* @param timing The timing parameters to apply when loading, as returned by Projector::getTimingParams.
+*
+* Loading the file (AlpImageFiles::openSequence, Projector::fileSequence) maps it and passes the
+* payloads to AlpSeqPut unchanged, so nothing is rendered, packed or sliced at startup. See
+* AlpSequenceFile.h for the layout.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int AlpFrames::writeSequenceFile(const std::filesystem::path& path, const long bitPlanes, std::vector<unsigned long> const& timing) const {
+	auto const align = [](uint64_t offset) { return (offset + ALP_SEQ_FILE_ALIGN - 1) / ALP_SEQ_FILE_ALIGN * ALP_SEQ_FILE_ALIGN; };
+	if (_format == PixelFormat::Binary ? bitPlanes != 1 : bitPlanes < 2 || bitPlanes > 8) {
+		std::cerr << "Error: Binary frames are stored with 1 bit plane, gray frames with 2 to 8." << std::endl;
+		return 1;
+	}
+	if (timing.size() != 5) {
+		std::cerr << "Error: `timing` must hold the 5 timing parameters." << std::endl;
+		return 1;
+	}
+
+	tAlpSeqFileHeader header = {};
+	memcpy(header.Magic, ALP_SEQ_FILE_MAGIC, sizeof(header.Magic));
+	header.HeaderBytes = sizeof(header);
+	header.Format = _format == PixelFormat::Binary ? 1 : 0;
+	header.Width = _width, header.Height = _height, header.FirstRow = _firstRow;
+	header.BitPlanes = bitPlanes, header.RowBytes = _rowBytes;
+	header.FrameCount = (uint32_t)_frameCount;
+	header.FrameBytes = frameBytes();
+	for (size_t i = 0; i < timing.size(); i++)
+		header.Timing[i] = (uint32_t)timing[i];
+	header.IndexOffset = sizeof(header);
+
+	std::vector<uint64_t> index(_frameCount);
+	uint64_t offset = align(header.IndexOffset + index.size() * sizeof(uint64_t));
+	for (auto& frameOffset : index) {
+		frameOffset = offset;
+		offset = align(offset + header.FrameBytes);
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	char const padding[ALP_SEQ_FILE_ALIGN] = {};
+	uint64_t position = header.IndexOffset + index.size() * sizeof(uint64_t);
+	file.write((char const*)&header, sizeof(header));
+	file.write((char const*)index.data(), index.size() * sizeof(uint64_t));
+	for (long frame = 0; frame < _frameCount && file; frame++) {
+		file.write(padding, index[frame] - position);
+		file.write((char const*)_imageData + frame * frameBytes(), frameBytes());
+		position = index[frame] + header.FrameBytes;
+	}
+	file.close();
+	if (!file) {
+		std::cerr << "Error: Cannot write " << path.string() << "." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+* @brief Marks frames as modified, for writes the frames cannot see.
+*
+* The drawing methods, at, renderFrames, renderRows and the conversions mark the frames they
+* write themselves. Writes through the pointer returned by operator() must be followed by
+* touch, otherwise Projector::updateSequence does not upload them.
+*
+* @throws std::invalid_argument if the frames are out of range.
+*/
+void AlpFrames::touch(const long firstFrame, const long frameCount) {
+	try {
+		if (firstFrame < 0 || frameCount < 0 || firstFrame + frameCount > _frameCount)
+			throw std::invalid_argument("Error: Frames to touch are out of range.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+	for (long frameNum = firstFrame; frameNum < firstFrame + frameCount; frameNum++)
+		markModified(frameNum);
+}
+
+// touch for one frame already validated by the caller: a single relaxed store
+void AlpFrames::markModified(const long frameNum) {
+	if (!_generations.empty())
+		_generations[frameNum].store(gGeneration.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/**
+* @brief The generation clock when frame `frameNum` was last modified.
+*
+* A frame was modified after a call of generationMark if its generation is at least the
+* mark returned. Views of foreign storage are not tracked and report the current clock.
+*/
+unsigned long long AlpFrames::generation(const long frameNum) const {
+	if (_generations.empty())
+		return gGeneration.load(std::memory_order_relaxed);
+	return _generations[frameNum].load(std::memory_order_relaxed);
+}
+
+/**
+* @brief Advances the generation clock shared by all frames and returns its new value.
+*
+* Take a mark before reading frames (e.g. to upload them); the frames modified afterwards are
+* those with generation(frameNum) >= mark. Marking is one atomic increment, and a modification
+* only stores the clock, so tracking costs nothing per pixel.
+*/
+unsigned long long AlpFrames::generationMark() {
+	return ++gGeneration;
+}
+
+/**
+* @brief Bytes per row of packed binary data (ALP_DATA_BINARY_TOPDOWN) for a DMD width.
+*
+* The ALP pads some DMD types: SXGA+ (1400) rows occupy 176 bytes, 1080p and WUXGA (1920)
+* rows occupy 256 bytes. All others hold exactly 8 pixels per byte.
+*/
+long AlpFrames::binaryRowBytes(const long width) {
+	switch (width) {
+	case 1400: return 176;
+	case 1920: return 256;
+	default: return (width + 7) / 8;
+	}
+}
+
+/**
+* @brief Number of ignored bytes at the start of a packed binary row, i.e. 1 for SXGA+.
+*/
+long AlpFrames::binaryRowLead(const long width) {
+	return width == 1400 ? 1 : 0;
+}
+
+/**
+* @brief Gray-code patterns needed to give each of `size` columns (or rows) a code of its own, i.e. ceil(log2(size)).
+*/
+long AlpFrames::grayCodeBits(const long size) {
+	long bits = 0;
+	while ((1L << bits) < size)
+		bits++;
+	return std::max(bits, 1L);
 }
 
 /**
 * @brief  operator() returns a pointer to the start of a frame.
 * @param  frameNum: the number of the frame.
 * @return Pointer to the start of the frame specified by frameNum.
-* @throws std::invalid_argument if frameNum is less than or equal to
-* zero or frameNum is greater than the number of frames.
+* @throws std::invalid_argument if frameNum is less than zero or not less than the number of frames.
+*
+* @note Checked on every call; loops over rows or pixels should validate once and use frame or row.
 */
 char unsigned* AlpFrames::operator()(const long frameNum) {
 	try {
-		if (frameNum <= 0 && frameNum > _frameCount)
+		if (frameNum < 0 || frameNum >= _frameCount)
 			throw std::invalid_argument("Error: `frameNum` invalid.");
 	}
 	catch (std::invalid_argument& e) {
@@ -100,7 +335,7 @@ char unsigned* AlpFrames::operator()(const long frameNum) {
 		Pause();
 		exit(1);
 	}
-	return _imageData + frameNum * _width * _height;
+	return _imageData + frameNum * frameBytes();
 }
 
 /**
@@ -116,55 +351,108 @@ char unsigned* AlpFrames::operator()(const long frameNum) {
 *
 * @return A reference to the pixel at the specified location in the specified frame.
 *
-* @throws std::invalid_argument if frame number is less than or equal to 0 and greater
-* than the number of frames, or if the x-coordinate is less than 0 or greater than or
-* equal to the width of the frame, or if the y-coordinate is less than 0 or greater
-* than or equal to the height of the frame.
+* @note Only available for Gray8 frames, use getPixel and setPixel for Binary frames.
+* @note Marks the frame as modified (see touch); use getPixel to only read.
+*
+* @throws std::invalid_argument if frame number is less than 0 or not less than the number
+* of frames, or if the x-coordinate is less than 0 or greater than or equal to the width
+* of the frame, or if the y-coordinate is less than 0 or greater than or equal to the
+* height of the frame.
+* @throws std::invalid_argument if the frames are stored as Binary.
 */
 char unsigned& AlpFrames::at(const long frameNum, const long x, const long y) {
 	try {
-		if (frameNum <= 0 && frameNum > _frameCount)
+		if (frameNum < 0 || frameNum >= _frameCount)
 			throw std::invalid_argument("Error: `frameNum` invalid.");
-		if (x < 0 || x > _width || y < 0 || y > _height)
+		if (x < 0 || x >= _width || y < 0 || y >= _height)
 			throw std::invalid_argument("Error: Pixel out of bounds.");
+		if (_format != PixelFormat::Gray8)
+			throw std::invalid_argument("Error: `at` requires Gray8 frames.");
 	}
 	catch (std::invalid_argument& e) {
 		std::cerr << e.what() << std::endl;
 		Pause();
 		exit(1);
 	}
-	return _imageData[frameNum * _width * _height + y * _width + x];
+	markModified(frameNum);
+	return row(frameNum, y)[x];
 }
 
 /**
-* @brief Returns a reference to the pixel at a specified location in the specified frame.
+* @brief Validates a range of frames once, for unchecked access through frame and row.
 *
-* @param  frameNum The number of the frame the pixel is located in.
-* @param  x The x-coordinate of the pixel in the frame.
-* @param  y The y-coordinate of the pixel in the frame.
+* @return int, 0 if frames `firstFrame` to `firstFrame + frameCount - 1` exist, otherwise 1.
+*/
+int AlpFrames::checkFrames(const long firstFrame, const long frameCount) const {
+	if (firstFrame < 0 || frameCount < 0 || firstFrame + frameCount > _frameCount) {
+		std::cerr << "Error: Frames " << firstFrame << " to " << firstFrame + frameCount - 1 << " out of range." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+* @brief Validates a rectangle of one frame once, for unchecked access through row.
 *
-* This method provides a way to access individual pixels in a frame. It is used to read
-* or modify the value of a specific pixel. The method checks if the given frame number
-* and coordinates are valid, if not it throws an invalid_argument exception.
+* @return int, 0 if the frame exists and the rectangle, at least one pixel wide, lies within it, otherwise 1.
+*/
+int AlpFrames::checkRegion(const long frameNum, const long x, const long y, const long width, const long height) const {
+	if (checkFrames(frameNum, 1) != 0)
+		return 1;
+	if (width <= 0 || height < 0 || x < 0 || x + width > _width || y < 0 || y + height > _height) {
+		std::cerr << "Error: Region " << width << "x" << height << " at (" << x << ", " << y << ") out of bounds." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+* @brief Returns whether the mirror at a location is switched on, for either storage format.
 *
-* @return A reference to the pixel at the specified location in the specified frame.
+* A Gray8 pixel counts as on if its most significant bit is set, like the ALP does for 1-bit sequences.
 *
-* @throws std::invalid_argument if frame number is less than 0 and greater than or
-* equal to the number of frames, or if the x-coordinate is less than 0 or greater
-* than or equal to the width of the frame, or if the y-coordinate is less than 0
-* or greater than or equal to the height of the frame.
+* @note Checked like at: quits if the pixel is out of range (see checkRegion).
 */
-void AlpFrames::fillRect(const long frameNum, const long x, const long y,
-	const long rectWidth, const long height, const char unsigned pixelValue) {
-	long const bottom = y + height - 1;
+bool AlpFrames::getPixel(const long frameNum, const long x, const long y) {
+	if (checkRegion(frameNum, x, y, 1, 1) != 0) {
+		Pause();
+		exit(1);
+	}
+	if (_format == PixelFormat::Gray8)
+		return (row(frameNum, y)[x] & 0x80) != 0;
+	long const bit = binaryRowLead(_width) * 8 + x;
+	return (row(frameNum, y)[bit / 8] & (0x80 >> (bit % 8))) != 0;
+}
 
+/**
+* @brief Sets a single pixel, for either storage format.
+*
+* Binary frames store the most significant bit of `pixelValue`.
+*
+* @return int, 0 on success, otherwise 1 if the pixel is out of range (see fillRect).
+*/
+int AlpFrames::setPixel(const long frameNum, const long x, const long y, const char unsigned pixelValue) {
+	return fillRect(frameNum, x, y, 1, 1, pixelValue);
+}
+
+/**
+* @brief Thresholds the frames of a Gray8 AlpFrames and stores them packed in these Binary frames.
+*
+* @param gray Source frames with the same frame count and dimensions.
+* @param threshold Pixels greater than or equal to this value are switched on.
+*
+* Uses the fastest AlpPack kernel the CPU supports. If rows need no padding, each
+* frame is converted in one call, otherwise row by row.
+*
+* @throws std::invalid_argument if these frames are not Binary, `gray` is not Gray8,
+* or the dimensions differ.
+*/
+void AlpFrames::packFrom(AlpFrames& gray, const char unsigned threshold) {
 	try {
-		if (frameNum < 0 && frameNum > _frameCount)
-			throw std::invalid_argument("Error: `frameNum` invalid.");
-		if (x < 0 || x + rectWidth > _width || y < 0 || bottom >= _height)
-			throw std::invalid_argument("Error: Attempting to draw out of bounds.");
-		if (rectWidth <= 0)
-			throw std::invalid_argument("Error: `rectWidth` must be a positive integer.");
+		if (_format != PixelFormat::Binary || gray._format != PixelFormat::Gray8)
+			throw std::invalid_argument("Error: `packFrom` converts Gray8 frames into Binary frames.");
+		if (gray._frameCount != _frameCount || gray._width != _width || gray._height != _height)
+			throw std::invalid_argument("Error: Frame counts and dimensions must match.");
 	}
 	catch (std::invalid_argument& e) {
 		std::cerr << e.what() << std::endl;
@@ -172,8 +460,205 @@ void AlpFrames::fillRect(const long frameNum, const long x, const long y,
 		exit(1);
 	}
 
-	for (long yPos = y; yPos <= bottom; yPos++)
-		memset(&at(frameNum, x, yPos), pixelValue, rectWidth);
+	long const lead = binaryRowLead(_width);
+	AlpThreadPool::shared().parallelFor(0, _frameCount, [&](long first, long last) {
+		for (long frameNum = first; frameNum < last; frameNum++) {
+			if (lead == 0 && _rowBytes * 8 == _width) {
+				AlpPackRow(gray.frame(frameNum), frame(frameNum), _width * _height, threshold);
+				continue;
+			}
+			for (long y = 0; y < _height; y++)
+				AlpPackRow(gray.row(frameNum, y), row(frameNum, y) + lead, _width, threshold);
+		}
+	});
+	touch(0, _frameCount);
+}
+
+/**
+* @brief Stores the `bitPlanes` most significant bit planes of each Gray8 frame as Binary frames.
+*
+* @param gray Source frames with the same dimensions and `_frameCount / bitPlanes` frames.
+* @param bitPlanes Planes per gray frame, 1 to 8. Frame `f * bitPlanes + k` receives bit 7 - k
+* of gray frame `f`, i.e. the planes follow each other from the most significant one.
+*
+* Used where the ALP needs planes as separate binary pictures, e.g. for binary patterns that
+* are encoded as the bits of one gray image. Uses the fastest AlpPack slicing kernel.
+*
+* @throws std::invalid_argument if these frames are not Binary, `gray` is not Gray8,
+* or the frame counts and dimensions do not match.
+*/
+void AlpFrames::sliceFrom(AlpFrames& gray, const long bitPlanes) {
+	try {
+		if (_format != PixelFormat::Binary || gray._format != PixelFormat::Gray8)
+			throw std::invalid_argument("Error: `sliceFrom` converts Gray8 frames into Binary frames.");
+		if (bitPlanes < 1 || bitPlanes > 8)
+			throw std::invalid_argument("Error: `bitPlanes` must be between 1 and 8.");
+		if (gray._frameCount * bitPlanes != _frameCount || gray._width != _width || gray._height != _height)
+			throw std::invalid_argument("Error: Frame counts and dimensions must match.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	long const lead = binaryRowLead(_width);
+	bool const whole = lead == 0 && _rowBytes * 8 == _width;
+	AlpThreadPool::shared().parallelFor(0, gray._frameCount, [&](long first, long last) {
+		char unsigned* planes[8];
+		for (long frameNum = first; frameNum < last; frameNum++) {
+			if (whole) {
+				for (long k = 0; k < bitPlanes; k++)
+					planes[k] = frame(frameNum * bitPlanes + k);
+				AlpSliceRow(gray.frame(frameNum), planes, _width * _height, bitPlanes);
+				continue;
+			}
+			for (long y = 0; y < _height; y++) {
+				for (long k = 0; k < bitPlanes; k++)
+					planes[k] = row(frameNum * bitPlanes + k, y) + lead;
+				AlpSliceRow(gray.row(frameNum, y), planes, _width, bitPlanes);
+			}
+		}
+	});
+	touch(0, _frameCount);
+}
+
+/**
+* @brief Rounds every gray value to the nearest level a sequence of `bitPlanes` bit planes displays.
+*
+* The ALP displays the `bitPlanes` most significant bits of each byte (ALP_DATA_MSB_ALIGN), which
+* truncates. Quantizing first rounds instead, and stores each level with its bits repeated
+* (e.g. 0, 85, 170, 255 for 2 bit planes), so the values stay exact when ALP_BITNUM is lowered further.
+*
+* @throws std::invalid_argument if the frames are not Gray8 or `bitPlanes` is not between 1 and 8.
+*/
+void AlpFrames::quantize(const long bitPlanes) {
+	try {
+		if (_format != PixelFormat::Gray8)
+			throw std::invalid_argument("Error: `quantize` requires Gray8 frames.");
+		if (bitPlanes < 1 || bitPlanes > 8)
+			throw std::invalid_argument("Error: `bitPlanes` must be between 1 and 8.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	long const top = (1L << bitPlanes) - 1;
+	char unsigned table[256];
+	for (long value = 0; value < 256; value++)
+		table[value] = (char unsigned)((value * top + 127) / 255 * 255 / top);
+	AlpThreadPool::shared().parallelFor(0, _frameCount, [&](long first, long last) {
+		char unsigned* const end = _imageData + last * frameBytes();
+		for (char unsigned* pixel = _imageData + first * frameBytes(); pixel != end; pixel++)
+			*pixel = table[*pixel];
+	});
+	touch(0, _frameCount);
+}
+
+/**
+* @brief Renders frames in parallel, one frame per task of the shared AlpThreadPool.
+*
+* @param firstFrame, frameCount The frames to render.
+* @param generator Called with an AlpFrames holding just frame `frameNum` (with the same
+* `_firstRow`, so row-dependent patterns such as dithering match drawing directly) and `frameNum`.
+* Frames are rendered concurrently, so the generator may only draw into the frame it is given.
+*
+* Use renderRows to spread a single frame over all cores instead.
+*
+* @return int, 0 on success, otherwise 1 if the frames are out of range (nothing is rendered).
+*/
+int AlpFrames::renderFrames(const long firstFrame, const long frameCount, std::function<void(AlpFrames&, long)> const& generator) {
+	if (checkFrames(firstFrame, frameCount) != 0)
+		return 1;
+
+	AlpThreadPool::shared().parallelFor(firstFrame, firstFrame + frameCount, [&](long first, long last) {
+		for (long frameNum = first; frameNum < last; frameNum++) {
+			AlpFrames view(frame(frameNum), 1, _width, _height, _format, _firstRow);
+			generator(view, frameNum);
+		}
+	});
+	for (long frameNum = firstFrame; frameNum < firstFrame + frameCount; frameNum++)
+		markModified(frameNum);
+	return 0;
+}
+
+/**
+* @brief Renders the rows of one frame in parallel, split into bands across the shared AlpThreadPool.
+*
+* @param frameNum The frame to render.
+* @param generator Called with a pointer to the first byte of row `y` (`_rowBytes` bytes) and `y`.
+*
+* @return int, 0 on success, otherwise 1 if the frame is out of range (nothing is rendered).
+*/
+int AlpFrames::renderRows(const long frameNum, std::function<void(char unsigned*, long)> const& generator) {
+	if (checkFrames(frameNum, 1) != 0)
+		return 1;
+
+	AlpThreadPool& pool = AlpThreadPool::shared();
+	// a few bands per thread, so that stealing can even out uneven rows
+	long const band = std::max(1L, _height / (long)(4 * pool.concurrency()));
+	pool.parallelFor(0, _height, [&](long first, long last) {
+		for (long y = first; y < last; y++)
+			generator(row(frameNum, y), y);
+	}, band);
+	markModified(frameNum);
+	return 0;
+}
+
+/**
+* @brief Sets or clears `width` consecutive bits of a packed binary row, starting at pixel `x`.
+*
+* Partial bytes at both ends are masked, all bytes in between are written with memset.
+*/
+void AlpFrames::fillRowBits(char unsigned* row, const long x, const long width, const bool on) {
+	long const first = binaryRowLead(_width) * 8 + x, last = first + width - 1;
+	char unsigned* const firstByte = row + first / 8;
+	char unsigned* const lastByte = row + last / 8;
+	char unsigned const headMask = (char unsigned)(0xFF >> (first % 8));
+	char unsigned const tailMask = (char unsigned)(0xFF << (7 - last % 8));
+
+	if (firstByte == lastByte) {
+		char unsigned const mask = headMask & tailMask;
+		*firstByte = on ? (*firstByte | mask) : (*firstByte & ~mask);
+		return;
+	}
+	*firstByte = on ? (*firstByte | headMask) : (*firstByte & ~headMask);
+	memset(firstByte + 1, on ? 0xFF : 0x00, lastByte - firstByte - 1);
+	*lastByte = on ? (*lastByte | tailMask) : (*lastByte & ~tailMask);
+}
+
+/**
+* @brief Fills a rectangle of one frame with a value.
+*
+* @param  frameNum The frame to draw into.
+* @param  x, y The top-left pixel of the rectangle.
+* @param  rectWidth, height The size of the rectangle; the width must be positive.
+*
+* The rectangle is validated once (checkRegion) and then written row by row without
+* further checks.
+*
+* @note Binary frames are written directly in packed form; `pixelValue` sets the
+* mirrors on if its most significant bit is set.
+*
+* @return int, 0 on success, otherwise 1 if the frame does not exist or the rectangle
+* does not lie within it (nothing is drawn).
+*/
+int AlpFrames::fillRect(const long frameNum, const long x, const long y,
+	const long rectWidth, const long height, const char unsigned pixelValue) {
+	if (checkRegion(frameNum, x, y, rectWidth, height) != 0)
+		return 1;
+	long const bottom = y + height - 1;
+
+	if (_format == PixelFormat::Binary)
+		for (long yPos = y; yPos <= bottom; yPos++)
+			fillRowBits(row(frameNum, yPos), x, rectWidth, (pixelValue & 0x80) != 0);
+	else
+		for (long yPos = y; yPos <= bottom; yPos++)
+			memset(row(frameNum, yPos) + x, pixelValue, rectWidth);
+	markModified(frameNum);
+	return 0;
 }
 
 /**
@@ -188,22 +673,118 @@ void AlpFrames::fillRect(const long frameNum, const long x, const long y,
 * @param width The width of the frames.
 * @param height The height of the frames.
 *
-* @throw runtime_error if the frames parameter is less than 2.
+* The frames are independent and are drawn in parallel (see renderFrames).
+*
+* @return int, 0 on success, otherwise 1 if the frames or the square are out of range.
+*
+* @throw invalid_argument if the frames parameter is less than 2.
 */
-void AlpFrames::drawMovingSquare(long frames, long width, long height) {
+int AlpFrames::drawMovingSquare(long frames, long width, long height) {
 	const long squareWidth = height / 5, dx = width - squareWidth, dy = height - squareWidth;
-	for (long frame = 0; frame < frames; frame++) {
-		try {
-			if (frames < 2)
-				throw std::invalid_argument("Error: `frames` must be a positive integer.");
-			fillRect(frame, frame * dx / (frames - 1), frame * dy / (frames - 1), squareWidth, squareWidth, 255);
-		}
-		catch (const std::runtime_error& e) {
-			std::cerr << e.what() << std::endl;
-			Pause();
-			exit(1);
-		}
+	try {
+		if (frames < 2)
+			throw std::invalid_argument("Error: `frames` must be a positive integer.");
 	}
+	catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+	std::atomic<int> failed(0);
+	if (renderFrames(0, frames, [&](AlpFrames& frame, long frameNum) {
+		failed |= frame.fillRect(0, frameNum * dx / (frames - 1), frameNum * dy / (frames - 1), squareWidth, squareWidth, 255);
+	}) != 0)
+		return 1;
+	return failed != 0 ? 1 : 0;
+}
+
+/**
+* @brief Fills a rectangle of the strip formed by all frames stacked on top of each other.
+*
+* @param x, y The top-left corner; `y` counts rows from the top of frame 0 and may lie in any frame.
+* @param rectWidth, height The size. The rectangle may cross frame boundaries.
+* @param pixelValue Gray value; binary frames switch the mirrors on if its most significant bit is set.
+*
+* Frames are stored one after another, so the strip is a single image of `_frameCount * _height`
+* rows. This is the image the ALP scrolls through in line scrolling mode (see Projector::scrollPattern).
+*
+* @throws std::invalid_argument if the rectangle is not inside the strip or `rectWidth` is not positive.
+*/
+void AlpFrames::fillStripRect(const long x, const long y, const long rectWidth, const long height, const char unsigned pixelValue) {
+	long const bottom = y + height - 1;
+
+	try {
+		if (x < 0 || x + rectWidth > _width || y < 0 || bottom >= _frameCount * _height)
+			throw std::invalid_argument("Error: Attempting to draw out of bounds.");
+		if (rectWidth <= 0)
+			throw std::invalid_argument("Error: `rectWidth` must be a positive integer.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	for (long yPos = y; yPos <= bottom; yPos++) {
+		char unsigned* const row = _imageData + (size_t)yPos * _rowBytes;
+		if (_format == PixelFormat::Binary)
+			fillRowBits(row, x, rectWidth, (pixelValue & 0x80) != 0);
+		else
+			memset(row + x, pixelValue, rectWidth);
+	}
+	touch(y / _height, bottom / _height - y / _height + 1);
+}
+
+/**
+* @brief Draws a full-width bar for line scrolling, which replaces a frame per bar position.
+*
+* The bar is drawn at the top of frame 1. Scrolling the window from row `barHeight` to row
+* `_height` moves it from the bottom edge of the DMD to the top edge, in steps of ALP_LINE_INC
+* rows, while only these two frames are uploaded.
+*
+* @param barHeight The height of the bar in rows.
+*
+* @throw invalid_argument if there are fewer than 2 frames or the bar is higher than a frame.
+*/
+void AlpFrames::drawScrollingBar(long barHeight) {
+	try {
+		if (_frameCount < 2)
+			throw std::invalid_argument("Error: A scrolling bar needs 2 frames.");
+		if (barHeight <= 0 || barHeight > _height)
+			throw std::invalid_argument("Error: `barHeight` must be between 1 and the frame height.");
+	}
+	catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+	fillStripRect(0, _height, _width, barHeight, 255);
+}
+
+/**
+* @brief Draws horizontal stripes over the whole strip, for line scrolling.
+*
+* The stripes repeat every 2 * `lWidth` rows. Scrolling the window from row 0 to row
+* 2 * `lWidth` - ALP_LINE_INC and repeating continuously drifts them without a visible jump,
+* if ALP_LINE_INC divides 2 * `lWidth`.
+*
+* @param lWidth The width of the stripes and of the gaps between them.
+*
+* @throw invalid_argument if the strip is not at least one stripe period higher than a frame.
+*/
+void AlpFrames::drawScrollingStripes(long lWidth) {
+	long const stripHeight = _frameCount * _height;
+	try {
+		if (lWidth <= 0 || _height + 2 * lWidth > stripHeight)
+			throw std::invalid_argument("Error: The strip must be at least one stripe period higher than a frame.");
+	}
+	catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+	for (long y = 0; y < stripHeight; y += 2 * lWidth)
+		fillStripRect(0, y, _width, std::min(lWidth, stripHeight - y), 255);
 }
 
 /**
@@ -218,19 +799,21 @@ void AlpFrames::drawMovingSquare(long frames, long width, long height) {
 * @param pHeight The height of the frames.
 * @param sqSize The size of the square.
 *
+* @return int, 0 on success, otherwise 1 if the square is out of bounds (see fillRect).
+*
 * @throw invalid_argument if the frames parameter is not equal to 1.
 */
-void AlpFrames::drawSquare(long frames, long vPad, long hPad, long sqSize) {
+int AlpFrames::drawSquare(long frames, long vPad, long hPad, long sqSize) {
 	try {
 		if (frames != 1)
 			throw std::invalid_argument("Error: `frames` must be 1.");
-		fillRect(frames - 1, hPad, vPad, sqSize, sqSize, 255);
 	}
 	catch (const std::invalid_argument& e) {
 		std::cerr << e.what() << std::endl;
 		Pause();
 		exit(1);
 	}
+	return fillRect(frames - 1, hPad, vPad, sqSize, sqSize, 255);
 }
 
 /**
@@ -246,23 +829,31 @@ void AlpFrames::drawSquare(long frames, long vPad, long hPad, long sqSize) {
 * @param spacing The spacing between lines.
 * @param lWidth The width of the lines.
 *
+* @return int, 0 on success, otherwise 1 if a line is out of bounds (see AlpDisplayList::rasterize).
+*
 * @throw invalid_argument if the frames parameter is not equal to 1.
 */
-void AlpFrames::drawVertialLines(long frames, long hPad, long spacing, long lWidth) {
+int AlpFrames::drawVertialLines(long frames, long hPad, long spacing, long lWidth) {
 	try {
 		if (frames != 1)
 			throw std::invalid_argument("Error: `frames` must be 1.");
-		for (int i = hPad; i < _width / lWidth; i++) {
-			if (i % 2 == 0)
-				fillRect(frames - 1, i * lWidth, 0, lWidth, _height, 255);
-			i += spacing;
-		}
 	}
 	catch (const std::invalid_argument& e) {
 		std::cerr << e.what() << std::endl;
 		Pause();
 		exit(1);
 	}
+	AlpDisplayList list(_width, _height);
+	recordVerticalLines(list, hPad, spacing, lWidth);
+	return list.rasterize(*this, frames - 1);
+}
+
+void AlpFrames::recordVerticalLines(AlpDisplayList& list, long hPad, long spacing, long lWidth) {
+	for (int i = hPad; i < _width / lWidth; i++) {
+		if (i % 2 == 0)
+			list.fillRect(i * lWidth, 0, lWidth, _height, 255);
+		i += spacing;
+	}
 }
 
 /**
@@ -278,23 +869,31 @@ void AlpFrames::drawVertialLines(long frames, long hPad, long spacing, long lWid
 * @param spacing The spacing between lines.
 * @param lWidth The width of the lines.
 *
+* @return int, 0 on success, otherwise 1 if a line is out of bounds (see AlpDisplayList::rasterize).
+*
 * @throw invalid_argument if the frames parameter is not equal to 1.
 */
-void AlpFrames::drawHorizontalLines(long frames, long hPad, long spacing, long lWidth) {
+int AlpFrames::drawHorizontalLines(long frames, long hPad, long spacing, long lWidth) {
 	try {
 		if (frames != 1)
 			throw std::invalid_argument("Error: `frames` must be 1.");
-		for (int i = 0; i < _height / lWidth; i++) {
-			if (i % 2 == 0)
-				fillRect(frames - 1, 0, i * lWidth, _width, lWidth, 255);
-			i += spacing;
-		}
 	}
 	catch (const std::invalid_argument& e) {
 		std::cerr << e.what() << std::endl;
 		Pause();
 		exit(1);
 	}
+	AlpDisplayList list(_width, _height);
+	recordHorizontalLines(list, spacing, lWidth);
+	return list.rasterize(*this, frames - 1);
+}
+
+void AlpFrames::recordHorizontalLines(AlpDisplayList& list, long spacing, long lWidth) {
+	for (int i = 0; i < _height / lWidth; i++) {
+		if (i % 2 == 0)
+			list.fillRect(0, i * lWidth, _width, lWidth, 255);
+		i += spacing;
+	}
 }
 
 /**
@@ -314,10 +913,24 @@ void AlpFrames::drawHorizontalLines(long frames, long hPad, long spacing, long l
 * @param lWidth The width of the lines.
 *
 * @note The method requires a frame count of exactly 1.
+* @note Both sets of lines are recorded into one AlpDisplayList and drawn in a single pass.
+*
+* @return int, 0 on success, otherwise 1 if a line is out of bounds (see AlpDisplayList::rasterize).
 */
-void AlpFrames::drawGrid(long frames, long vPad, long hPad, long vSpacing, long hSpacing, long lWidth) {
-	drawVertialLines(frames, hPad, hSpacing, lWidth);
-	drawHorizontalLines(frames, vPad, vSpacing, lWidth);
+int AlpFrames::drawGrid(long frames, long vPad, long hPad, long vSpacing, long hSpacing, long lWidth) {
+	try {
+		if (frames != 1)
+			throw std::invalid_argument("Error: `frames` must be 1.");
+	}
+	catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+	AlpDisplayList list(_width, _height);
+	recordVerticalLines(list, hPad, hSpacing, lWidth);
+	recordHorizontalLines(list, vSpacing, lWidth);
+	return list.rasterize(*this, frames - 1);
 }
 
 /**
@@ -330,15 +943,233 @@ void AlpFrames::drawGrid(long frames, long vPad, long hPad, long vSpacing, long
 * @param hPad Horizontal padding of the checkerboard pattern
 * @param sqSize Size of each square of the checkerboard pattern
 *
-* @return None
+* The squares are recorded into an AlpDisplayList, which merges them into row spans and
+* draws each band of rows once, instead of filling every square separately.
+*
+* @throw invalid_argument if the frames parameter is not equal to 1.
+*
+* @return int, 0 on success, otherwise 1 if a square is out of bounds (see AlpDisplayList::rasterize).
 */
-void AlpFrames::drawCheckerBoard(long frames, long vPad, long hPad, long sqSize) {
+int AlpFrames::drawCheckerBoard(long frames, long vPad, long hPad, long sqSize) {
+	try {
+		if (frames != 1)
+			throw std::invalid_argument("Error: `frames` must be 1.");
+	}
+	catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+	AlpDisplayList list(_width, _height);
+	list.reserve((size_t)(_height / sqSize) * (_width / sqSize) / 2 + 1);
 	for (int i = 0; i < _height / sqSize; i++) {
 		for (int j = 0; j < _width / sqSize; j++) {
-			if (j % 2 == 0 && i % 2 == 0 || j % 2 == 0 && i == 0)
-				drawSquare(frames, hPad + i * sqSize, vPad + j * sqSize, sqSize);
+			if (j % 2 == 0 && i % 2 == 0)
+				list.fillRect(vPad + j * sqSize, hPad + i * sqSize, sqSize, sqSize, 255);
 			else if (j % 2 != 0 && i % 2 != 0)
-				drawSquare(frames, hPad + i * sqSize, vPad + j * sqSize, sqSize);
+				list.fillRect(vPad + j * sqSize, hPad + i * sqSize, sqSize, sqSize, 255);
 		}
 	}
+	return list.rasterize(*this, frames - 1);
+}
+
+/**
+* @brief Draws a horizontal gray ramp with every level a sequence of `bitPlanes` bit planes displays.
+*
+* The width is divided into 2^`bitPlanes` equally wide steps from black (left) to white (right),
+* stored as in quantize. The rows are identical, so one row is computed and copied.
+*
+* @param frames Number of frames to be generated
+* @param bitPlanes The bit depth of the sequence, 1 to 8
+*
+* @throw invalid_argument if the frames parameter is not equal to 1, the frames are not Gray8,
+* or `bitPlanes` is not between 1 and 8.
+*/
+void AlpFrames::drawGrayRamp(long frames, long bitPlanes) {
+	try {
+		if (frames != 1)
+			throw std::invalid_argument("Error: `frames` must be 1.");
+		if (_format != PixelFormat::Gray8)
+			throw std::invalid_argument("Error: `drawGrayRamp` requires Gray8 frames.");
+		if (bitPlanes < 1 || bitPlanes > 8)
+			throw std::invalid_argument("Error: `bitPlanes` must be between 1 and 8.");
+	}
+	catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+	long const levels = 1L << bitPlanes;
+	char unsigned* const frame = operator()(frames - 1);
+	for (long x = 0; x < _width; x++)
+		frame[x] = (char unsigned)(x * levels / _width * 255 / (levels - 1));
+	for (long y = 1; y < _height; y++)
+		memcpy(frame + y * _rowBytes, frame, _width);
+	touch(frames - 1);
+}
+
+namespace {
+
+// Ordered (Bayer) dither thresholds, 0..63
+const char unsigned bayer8[8][8] = {
+	{ 0, 32, 8, 40, 2, 34, 10, 42 },
+	{ 48, 16, 56, 24, 50, 18, 58, 26 },
+	{ 12, 44, 4, 36, 14, 46, 6, 38 },
+	{ 60, 28, 52, 20, 62, 30, 54, 22 },
+	{ 3, 35, 11, 43, 1, 33, 9, 41 },
+	{ 51, 19, 59, 27, 49, 17, 57, 25 },
+	{ 15, 47, 7, 39, 13, 45, 5, 37 },
+	{ 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+}
+
+/**
+* @brief Fills the first frame from gray values that vary only along x (`columns`) or only along y.
+*
+* @param profile `_width` values for columns, `_height` values for rows.
+*
+* Gray8 column frames compute one row and copy it to all others. Binary frames are ordered
+* dithered with an 8x8 Bayer matrix, so they need 8 distinct rows at most (row frames: one per
+* value and dither row); each is thresholded in a loop the compiler vectorizes, packed with
+* AlpPackRow, and copied to the other rows.
+* Values 0 and 255 stay black and white, so two-level patterns are not affected by the dither.
+*/
+void AlpFrames::drawProfile(char unsigned const* profile, const bool columns) {
+	char unsigned* const frame = operator()(0);
+	bool const binary = _format == PixelFormat::Binary;
+	std::vector<char unsigned> thresholds(_width), row(_width);
+	auto const makeRow = [&](char unsigned* target, long y) {
+		if (!binary) {
+			if (columns)
+				memcpy(target, profile, _width);
+			else
+				memset(target, profile[y], _width);
+			return;
+		}
+		char unsigned const* const dither = bayer8[(y + _firstRow) & 7];
+		for (long x = 0; x < _width; x++)
+			thresholds[x] = (char unsigned)(dither[x & 7] * 4 + 2);
+		for (long x = 0; x < _width; x++)
+			row[x] = (columns ? profile[x] : profile[y]) > thresholds[x] ? 255 : 0;
+		memset(target, 0, _rowBytes);
+		AlpPackRow(row.data(), target + binaryRowLead(_width), _width, 128);
+	};
+
+	// rows with the same value and dither row are identical, e.g. all rows of a stripe
+	if (!columns) {
+		std::vector<long> made(binary ? 8 * 256 : 0, -1);
+		for (long y = 0; y < _height; y++) {
+			if (!binary) {
+				makeRow(frame + y * _rowBytes, y);
+				continue;
+			}
+			long& source = made[((y + _firstRow) & 7) * 256 + profile[y]];
+			if (source >= 0)
+				memcpy(frame + y * _rowBytes, frame + source * _rowBytes, _rowBytes);
+			else
+				makeRow(frame + y * _rowBytes, y), source = y;
+		}
+		return;
+	}
+	long const distinct = std::min(binary ? 8L : 1L, _height);
+	for (long y = 0; y < distinct; y++)
+		makeRow(frame + y * _rowBytes, y);
+	for (long y = distinct; y < _height; y++)
+		memcpy(frame + y * _rowBytes, frame + (y % distinct) * _rowBytes, _rowBytes);
+}
+
+/**
+* @brief Draws a complete set of Gray-code stripe patterns, for structured-light scanning.
+*
+* @param firstFrame The first frame to draw into.
+* @param bits Patterns of the set, most significant first. Column (or row) `i` lies in stripe
+* `i * 2^bits / size` and is lit in pattern `k` if bit `bits - 1 - k` of the Gray code
+* `stripe ^ (stripe >> 1)` of its stripe is set. grayCodeBits gives every column its own stripe.
+* @param columns True for vertical stripes coding the column, false for horizontal stripes coding the row.
+* @param inverses If true, every pattern is followed by its inverse, so a decoder can compare
+* both instead of guessing a threshold.
+*
+* Draws `bits` frames, or `2 * bits` with inverses, in parallel (renderFrames). Adjacent stripes
+* differ in one pattern only, so decoding errors at stripe edges stay within one stripe.
+*
+* @return int, 0 on success, otherwise 1 (see renderFrames).
+*
+* @throws std::invalid_argument if `bits` is not between 1 and 24 or the frames are out of range.
+*/
+int AlpFrames::drawGrayCode(const long firstFrame, const long bits, const bool columns, const bool inverses) {
+	long const patterns = inverses ? 2 * bits : bits;
+	try {
+		if (bits < 1 || bits > 24)
+			throw std::invalid_argument("Error: `bits` must be between 1 and 24.");
+		if (firstFrame < 0 || firstFrame + patterns > _frameCount)
+			throw std::invalid_argument("Error: The Gray-code set does not fit into the frames.");
+	}
+	catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	long const size = columns ? _width : _height;
+	return renderFrames(firstFrame, patterns, [&](AlpFrames& frame, long frameNum) {
+		long const pattern = frameNum - firstFrame;
+		long const bit = bits - 1 - (inverses ? pattern / 2 : pattern);
+		char unsigned const on = inverses && pattern % 2 == 1 ? 0 : 255;
+		std::vector<char unsigned> profile(size);
+		for (long i = 0; i < size; i++) {
+			unsigned long long const stripe = ((unsigned long long)i << bits) / size;
+			profile[i] = ((stripe ^ (stripe >> 1)) >> bit & 1) != 0 ? on : (char unsigned)(255 - on);
+		}
+		frame.drawProfile(profile.data(), columns);
+	});
+}
+
+/**
+* @brief Draws an N-step sinusoidal phase-shift set, for structured-light scanning.
+*
+* @param firstFrame The first frame to draw into.
+* @param steps Patterns of the set, at least 3. Pattern `n` has the intensity
+* 1/2 + 1/2 cos(phi - 2 pi n / steps) with phi = 2 pi i / period at column (or row) `i`, so a
+* decoder recovers phi = atan2(sum I_n sin(2 pi n / steps), sum I_n cos(2 pi n / steps)).
+* @param period Pixels per sine period, at least 2.
+* @param columns True for a phase varying along x, false along y.
+* @param bitPlanes For Gray8 frames, the bit planes of the sequence: intensities are rounded to
+* its levels and stored as in quantize. Binary frames are dithered instead (see drawProfile).
+*
+* Draws `steps` frames in parallel (renderFrames).
+*
+* @return int, 0 on success, otherwise 1 (see renderFrames).
+*
+* @throws std::invalid_argument if a parameter is out of range or the frames are out of range.
+*/
+int AlpFrames::drawPhaseShift(const long firstFrame, const long steps, const long period, const bool columns, const long bitPlanes) {
+	try {
+		if (steps < 3)
+			throw std::invalid_argument("Error: A phase-shift set needs at least 3 steps.");
+		if (period < 2)
+			throw std::invalid_argument("Error: The period must be at least 2 pixels.");
+		if (bitPlanes < 1 || bitPlanes > 8)
+			throw std::invalid_argument("Error: `bitPlanes` must be between 1 and 8.");
+		if (firstFrame < 0 || firstFrame + steps > _frameCount)
+			throw std::invalid_argument("Error: The phase-shift set does not fit into the frames.");
+	}
+	catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	long const size = columns ? _width : _height;
+	long const levels = _format == PixelFormat::Binary ? 255 : (1L << bitPlanes) - 1;
+	double const pi = 3.14159265358979323846;
+	return renderFrames(firstFrame, steps, [&](AlpFrames& frame, long frameNum) {
+		double const shift = 2 * pi * (frameNum - firstFrame) / steps;
+		std::vector<char unsigned> profile(size);
+		for (long i = 0; i < size; i++) {
+			double const intensity = 0.5 + 0.5 * std::cos(2 * pi * (i % period) / period - shift);
+			profile[i] = (char unsigned)(std::lround(intensity * levels) * 255 / levels);
+		}
+		frame.drawProfile(profile.data(), columns);
+	});
 }
\ No newline at end of file
@@ -1,26 +1,105 @@
 #pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+class AlpDisplayList;
 
 class AlpFrames {
 public:
-	AlpFrames(const long frames, const long width, const long height);
+	/**
+	* @brief Storage format of the frames.
+	*
+	* Gray8: one byte per mirror (ALP_DATA_MSB_ALIGN).
+	* Binary: eight mirrors per byte, bit 7 = leftmost mirror, top row first (ALP_DATA_BINARY_TOPDOWN).
+	*/
+	enum class PixelFormat { Gray8, Binary };
+
+	AlpFrames(const long frames, const long width, const long height, const PixelFormat format = PixelFormat::Gray8, const long firstRow = 0);
+	AlpFrames(char unsigned* imageData, const long frames, const long width, const long height, const PixelFormat format = PixelFormat::Gray8, const long firstRow = 0);
+	AlpFrames(const AlpFrames& a);
 	~AlpFrames(void);
 
 	char unsigned* operator()(const long frameNum);
 
 	char unsigned& at(const long frameNum, const long x, const long y);
 
-	void fillRect(const long frameNum, const long x, const long y,
+	bool getPixel(const long frameNum, const long x, const long y);
+	int setPixel(const long frameNum, const long x, const long y, const char unsigned pixelValue);
+
+	// Unchecked access for per-pixel loops: validate the frames or region once with checkFrames or
+	// checkRegion (as fillRect, renderFrames and renderRows do), then write through raw rows, which
+	// inline to plain loads and stores. Only debug builds assert the bounds, and writes are not
+	// tracked, so call touch for the frames written.
+	int checkFrames(const long firstFrame, const long frameCount) const;
+	int checkRegion(const long frameNum, const long x, const long y, const long width, const long height) const;
+
+	char unsigned* frame(const long frameNum) {
+		assert(frameNum >= 0 && frameNum < _frameCount);
+		return _imageData + (size_t)frameNum * _height * _rowBytes;
+	}
+	char unsigned* row(const long frameNum, const long y) {
+		assert(frameNum >= 0 && frameNum < _frameCount && y >= 0 && y < _height);
+		return _imageData + ((size_t)frameNum * _height + y) * _rowBytes;
+	}
+
+	int fillRect(const long frameNum, const long x, const long y,
 		const long width, const long height, const char unsigned pixelValue);
 
-	void drawMovingSquare(long frames, long width, long height);
-	void drawSquare(long frames, long vPad, long hPad, long sqSize);
-	void drawVertialLines(long frames, long hPad, long spacing, long lWidth);
-	void drawHorizontalLines(long frames, long hPad, long spacing, long lWidth);
-	void drawGrid(long frames, long vPad, long hPad, long vSpacing, long hSpacing, long lWidth);
-	void drawCheckerBoard(long frames, long vPad, long hPad, long sqSize);
+	void fillStripRect(const long x, const long y, const long rectWidth, const long height, const char unsigned pixelValue);
+
+	int drawMovingSquare(long frames, long width, long height);
+	void drawScrollingBar(long barHeight);
+	void drawScrollingStripes(long lWidth);
+	int drawSquare(long frames, long vPad, long hPad, long sqSize);
+	int drawVertialLines(long frames, long hPad, long spacing, long lWidth);
+	int drawHorizontalLines(long frames, long hPad, long spacing, long lWidth);
+	int drawGrid(long frames, long vPad, long hPad, long vSpacing, long hSpacing, long lWidth);
+	int drawCheckerBoard(long frames, long vPad, long hPad, long sqSize);
+	void drawGrayRamp(long frames, long bitPlanes);
+	int drawGrayCode(const long firstFrame, const long bits, const bool columns, const bool inverses = true);
+	int drawPhaseShift(const long firstFrame, const long steps, const long period, const bool columns, const long bitPlanes = 8);
+
+	int renderFrames(const long firstFrame, const long frameCount, std::function<void(AlpFrames&, long)> const& generator);
+	int renderRows(const long frameNum, std::function<void(char unsigned*, long)> const& generator);
+
+	void packFrom(AlpFrames& gray, const char unsigned threshold = 128);
+	void sliceFrom(AlpFrames& gray, const long bitPlanes);
+	void quantize(const long bitPlanes);
+
+	size_t frameBytes() const;
+	unsigned long long contentHash() const;
+
+	void touch(const long firstFrame, const long frameCount = 1);
+	unsigned long long generation(const long frameNum) const;
+	static unsigned long long generationMark();
+	int writeSequenceFile(const std::filesystem::path& path, const long bitPlanes, std::vector<unsigned long> const& timing) const;
+
+	static long binaryRowBytes(const long width);
+	static long binaryRowLead(const long width);
+	static long grayCodeBits(const long size);
 
 	const long _frameCount, _width, _height;
+	const PixelFormat _format;
+	const long _rowBytes;
+	// DMD row shown by row 0 of the frames; frames of an area of interest hold only its rows
+	const long _firstRow;
 
 private:
+	friend class AlpDisplayList;
+
+	void recordVerticalLines(AlpDisplayList& list, long hPad, long spacing, long lWidth);
+	void recordHorizontalLines(AlpDisplayList& list, long spacing, long lWidth);
+
+	void fillRowBits(char unsigned* row, const long x, const long width, const bool on);
+	void markModified(const long frameNum);
+	void drawProfile(char unsigned const* profile, const bool columns);
+
+	const bool _ownsData;
 	char unsigned* const _imageData;
-};
\ No newline at end of file
+	// per frame, the generation clock when it was last modified; empty for views of foreign storage
+	std::vector<std::atomic<unsigned long long>> _generations;
+};
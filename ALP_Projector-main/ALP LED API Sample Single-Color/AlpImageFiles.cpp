@@ -0,0 +1,326 @@
+/**
+* @file AlpImageFiles.cpp
+*
+* @brief Memory-mapped PGM and raw gray8 files, see AlpImageFiles.h.
+*/
+
+#include "stdafx.h"
+#include "AlpImageFiles.h"
+#include "AlpSequenceFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <string>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Skips whitespace and comments (from '#' to the end of the line) of a PGM header
+void SkipSpace(char unsigned const* data, size_t bytes, size_t& position) {
+	while (position < bytes) {
+		if (data[position] == '#')
+			while (position < bytes && data[position] != '\n')
+				position++;
+		else if (isspace(data[position]))
+			position++;
+		else
+			return;
+	}
+}
+
+bool ReadNumber(char unsigned const* data, size_t bytes, size_t& position, long& value) {
+	SkipSpace(data, bytes, position);
+	if (position >= bytes || !isdigit(data[position]))
+		return false;
+	value = 0;
+	while (position < bytes && isdigit(data[position])) {
+		if (value > 100000)
+			return false;
+		value = value * 10 + (data[position++] - '0');
+	}
+	return true;
+}
+
+std::string Lower(std::string text) {
+	std::transform(text.begin(), text.end(), text.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+	return text;
+}
+
+}
+
+AlpImageFiles::AlpImageFiles()
+	: _frameCount(0), _width(0), _height(0), _firstRow(0), _bitPlanes(0) {
+}
+
+AlpImageFiles::~AlpImageFiles() {
+	close();
+}
+
+/**
+* @brief Maps a binary PGM file (P5) holding one or more gray8 images.
+*
+* Only the headers are read. The maximum gray value must be 255, as the pixels are used
+* without scaling.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int AlpImageFiles::openPgm(const std::filesystem::path& path) {
+	Mapping mapping;
+	if (map(path, mapping) != 0)
+		return 1;
+
+	size_t position = 0;
+	do {
+		long width = 0, height = 0, maxValue = 0;
+		if (position + 2 > mapping.bytes || mapping.address[position] != 'P' || mapping.address[position + 1] != '5') {
+			std::cerr << "Error: " << path.string() << " is not a binary PGM file." << std::endl;
+			return 1;
+		}
+		position += 2;
+		if (!ReadNumber(mapping.address, mapping.bytes, position, width) || !ReadNumber(mapping.address, mapping.bytes, position, height)
+			|| !ReadNumber(mapping.address, mapping.bytes, position, maxValue) || position >= mapping.bytes || width == 0 || height == 0) {
+			std::cerr << "Error: " << path.string() << " has an invalid PGM header." << std::endl;
+			return 1;
+		}
+		if (maxValue != 255) {
+			std::cerr << "Error: " << path.string() << " must have a maximum gray value of 255." << std::endl;
+			return 1;
+		}
+		position++;	// the single whitespace character ending the header
+		if (position + (size_t)width * height > mapping.bytes) {
+			std::cerr << "Error: " << path.string() << " is truncated." << std::endl;
+			return 1;
+		}
+		if (addChunk(mapping.address + position, 1, width, height) != 0)
+			return 1;
+		position += (size_t)width * height;
+		SkipSpace(mapping.address, mapping.bytes, position);
+	} while (position < mapping.bytes);
+	return 0;
+}
+
+/**
+* @brief Maps a raw file of gray8 frames, one byte per pixel, stored back to back without headers.
+*
+* @param width, height The frame dimensions. The file size must be a multiple of the frame size.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int AlpImageFiles::openRaw(const std::filesystem::path& path, const long width, const long height) {
+	if (width <= 0 || height <= 0) {
+		std::cerr << "Error: Raw frame dimensions must be positive integers." << std::endl;
+		return 1;
+	}
+	Mapping mapping;
+	if (map(path, mapping) != 0)
+		return 1;
+	size_t const frameBytes = (size_t)width * height;
+	if (mapping.bytes % frameBytes != 0) {
+		std::cerr << "Error: The size of " << path.string() << " is not a multiple of " << width << " x " << height << " pixels." << std::endl;
+		return 1;
+	}
+	return addChunk(mapping.address, (long)(mapping.bytes / frameBytes), width, height);
+}
+
+/**
+* @brief Maps all PGM files of a directory in the order of their names, and raw files if their dimensions are given.
+*
+* @param rawWidth, rawHeight The frame dimensions of *.raw files; 0 ignores them.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int AlpImageFiles::openDirectory(const std::filesystem::path& path, const long rawWidth, const long rawHeight) {
+	std::vector<std::filesystem::path> files;
+	std::error_code error;
+	for (auto const& entry : std::filesystem::directory_iterator(path, error))
+		if (entry.is_regular_file())
+			files.push_back(entry.path());
+	if (error) {
+		std::cerr << "Error: Cannot read the directory " << path.string() << "." << std::endl;
+		return 1;
+	}
+	std::sort(files.begin(), files.end());
+
+	for (auto const& file : files) {
+		std::string const extension = Lower(file.extension().string());
+		if (extension == ".pgm" && openPgm(file) != 0)
+			return 1;
+		if (extension == ".raw" && rawWidth > 0 && openRaw(file, rawWidth, rawHeight) != 0)
+			return 1;
+	}
+	return 0;
+}
+
+/**
+* @brief Maps a pre-packed sequence file (.alpseq), see AlpSequenceFile.h.
+*
+* Only the header and the frame index are read. Frames stored back to back form one chunk,
+* which is binary if the file holds packed frames. Must be the only file opened.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int AlpImageFiles::openSequence(const std::filesystem::path& path) {
+	if (!_chunks.empty()) {
+		std::cerr << "Error: A sequence file cannot be combined with other files." << std::endl;
+		return 1;
+	}
+	Mapping mapping;
+	if (map(path, mapping) != 0)
+		return 1;
+
+	tAlpSeqFileHeader header;
+	bool valid = mapping.bytes >= sizeof(header);
+	if (valid) {
+		memcpy(&header, mapping.address, sizeof(header));
+		AlpFrames::PixelFormat const format = header.Format == 1 ? AlpFrames::PixelFormat::Binary : AlpFrames::PixelFormat::Gray8;
+		valid = memcmp(header.Magic, ALP_SEQ_FILE_MAGIC, sizeof(header.Magic)) == 0 && header.HeaderBytes == sizeof(header)
+			&& header.Format <= 1 && header.Width > 0 && header.Height > 0 && header.FirstRow >= 0 && header.FrameCount > 0
+			&& (format == AlpFrames::PixelFormat::Binary ? header.BitPlanes == 1 : header.BitPlanes >= 2 && header.BitPlanes <= 8)
+			&& header.RowBytes == (format == AlpFrames::PixelFormat::Binary ? AlpFrames::binaryRowBytes(header.Width) : header.Width)
+			&& header.FrameBytes == (uint64_t)header.RowBytes * header.Height
+			&& header.IndexOffset <= mapping.bytes && (mapping.bytes - header.IndexOffset) / sizeof(uint64_t) >= header.FrameCount;
+	}
+	std::vector<uint64_t> index;
+	if (valid) {
+		index.resize(header.FrameCount);
+		memcpy(index.data(), mapping.address + header.IndexOffset, index.size() * sizeof(uint64_t));
+		for (uint64_t const offset : index)
+			valid = valid && offset % ALP_SEQ_FILE_ALIGN == 0 && offset <= mapping.bytes && mapping.bytes - offset >= header.FrameBytes;
+	}
+	if (!valid) {
+		std::cerr << "Error: " << path.string() << " is not a valid sequence file." << std::endl;
+		return 1;
+	}
+
+	AlpFrames::PixelFormat const format = header.Format == 1 ? AlpFrames::PixelFormat::Binary : AlpFrames::PixelFormat::Gray8;
+	for (size_t first = 0, last; first < index.size(); first = last) {
+		for (last = first + 1; last < index.size() && index[last] == index[last - 1] + header.FrameBytes; last++)
+			;
+		if (addChunk(mapping.address + index[first], (long)(last - first), header.Width, header.Height, format, header.FirstRow) != 0)
+			return 1;
+	}
+	_bitPlanes = header.BitPlanes;
+	_timing.assign(header.Timing, header.Timing + 5);
+	return 0;
+}
+
+// Unmaps all files; chunks obtained before become invalid
+void AlpImageFiles::close() {
+	_chunks.clear();
+	for (auto const& mapping : _mappings)
+		unmap(mapping);
+	_mappings.clear();
+	_frameCount = 0, _width = 0, _height = 0, _firstRow = 0, _bitPlanes = 0;
+	_timing.clear();
+}
+
+long AlpImageFiles::getFrameCount() const {
+	return _frameCount;
+}
+
+long AlpImageFiles::getWidth() const {
+	return _width;
+}
+
+long AlpImageFiles::getHeight() const {
+	return _height;
+}
+
+long AlpImageFiles::getFirstRow() const {
+	return _firstRow;
+}
+
+long AlpImageFiles::getBitPlanes() const {
+	return _bitPlanes;
+}
+
+std::vector<unsigned long> AlpImageFiles::getTimingParams() const {
+	return _timing;
+}
+
+size_t AlpImageFiles::chunkCount() const {
+	return _chunks.size();
+}
+
+/**
+* @brief Frames stored back to back in a mapped file, in the order they were opened.
+*
+* The frames point into the mapping; they stay valid until close() or destruction.
+*/
+AlpFrames& AlpImageFiles::chunk(const size_t index) {
+	return *_chunks.at(index);
+}
+
+/**
+* @brief Maps a whole file copy-on-write.
+*
+* Writing to the pages copies them privately, so the file itself is never modified.
+*/
+int AlpImageFiles::map(const std::filesystem::path& path, Mapping& mapping) {
+	std::error_code error;
+	uintmax_t const size = std::filesystem::file_size(path, error);
+	if (error || size == 0) {
+		std::cerr << "Error: Cannot open " << path.string() << " or it is empty." << std::endl;
+		return 1;
+	}
+	mapping.bytes = (size_t)size;
+	mapping.address = nullptr;
+#ifdef _WIN32
+	HANDLE const file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file != INVALID_HANDLE_VALUE) {
+		HANDLE const section = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		if (section != NULL) {
+			mapping.address = (char unsigned*)MapViewOfFile(section, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(section);	// the view keeps the section alive
+		}
+		CloseHandle(file);
+	}
+#else
+	int const file = open(path.c_str(), O_RDONLY);
+	if (file >= 0) {
+		void* const address = mmap(nullptr, mapping.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		if (address != MAP_FAILED) {
+			mapping.address = (char unsigned*)address;
+			madvise(address, mapping.bytes, MADV_SEQUENTIAL);
+		}
+		::close(file);	// the mapping keeps the file open
+	}
+#endif
+	if (mapping.address == nullptr) {
+		std::cerr << "Error: Cannot map " << path.string() << "." << std::endl;
+		return 1;
+	}
+	_mappings.push_back(mapping);
+	return 0;
+}
+
+void AlpImageFiles::unmap(Mapping const& mapping) {
+#ifdef _WIN32
+	UnmapViewOfFile(mapping.address);
+#else
+	munmap(mapping.address, mapping.bytes);
+#endif
+}
+
+int AlpImageFiles::addChunk(char unsigned* data, const long frames, const long width, const long height,
+	const AlpFrames::PixelFormat format, const long firstRow) {
+	if (_bitPlanes != 0) {
+		std::cerr << "Error: A sequence file cannot be combined with other files." << std::endl;
+		return 1;
+	}
+	if (_chunks.empty())
+		_width = width, _height = height, _firstRow = firstRow;
+	else if (width != _width || height != _height) {
+		std::cerr << "Error: All images must have the same dimensions (" << _width << " x " << _height << ")." << std::endl;
+		return 1;
+	}
+	_chunks.push_back(std::make_unique<AlpFrames>(data, frames, width, height, format, firstRow));
+	_frameCount += frames;
+	return 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+/**
+* @file AlpImageFiles.h
+*
+* @brief Memory-mapped gray8 image files (binary PGM or raw) and pre-packed sequence files (.alpseq),
+* wrapped as AlpFrames without copying.
+*
+* Files are mapped copy-on-write: nothing is read when a file is opened, pages are faulted
+* in when they are first accessed (e.g. by AlpSeqPut), and drawing into the frames never
+* modifies the files. Frames that lie back to back in one file (raw files) form one chunk,
+* i.e. one AlpFrames of several frames; every PGM image is a chunk of its own, since a
+* header precedes it. Chunks can be passed to AlpSeqPut directly, see Projector::fileSequence.
+*
+* A sequence file (see AlpSequenceFile.h) also carries the bit planes, timing parameters and
+* area of interest of its sequence; its frames may be packed already and cannot be combined
+* with other files.
+*
+* All files must have the same dimensions. The functions return 0 on success, otherwise 1
+* after printing the reason.
+*/
+
+#include "AlpFrames.h"
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+class AlpImageFiles {
+public:
+	AlpImageFiles();
+	~AlpImageFiles();
+
+	AlpImageFiles(const AlpImageFiles&) = delete;
+	AlpImageFiles& operator=(const AlpImageFiles&) = delete;
+
+	int openPgm(const std::filesystem::path& path);
+	int openRaw(const std::filesystem::path& path, const long width, const long height);
+	int openDirectory(const std::filesystem::path& path, const long rawWidth = 0, const long rawHeight = 0);
+	int openSequence(const std::filesystem::path& path);
+	void close();
+
+	long getFrameCount() const;
+	long getWidth() const;
+	long getHeight() const;
+	long getFirstRow() const;
+	// Of a sequence file: ALP_BITPLANES and timing parameters, otherwise 0 and empty
+	long getBitPlanes() const;
+	std::vector<unsigned long> getTimingParams() const;
+
+	size_t chunkCount() const;
+	AlpFrames& chunk(const size_t index);
+
+private:
+	struct Mapping {
+		char unsigned* address;
+		size_t bytes;
+	};
+
+	int map(const std::filesystem::path& path, Mapping& mapping);
+	void unmap(Mapping const& mapping);
+	int addChunk(char unsigned* data, const long frames, const long width, const long height,
+		const AlpFrames::PixelFormat format = AlpFrames::PixelFormat::Gray8, const long firstRow = 0);
+
+	std::vector<Mapping> _mappings;
+	std::vector<std::unique_ptr<AlpFrames>> _chunks;
+	long _frameCount, _width, _height, _firstRow, _bitPlanes;
+	std::vector<unsigned long> _timing;
+};
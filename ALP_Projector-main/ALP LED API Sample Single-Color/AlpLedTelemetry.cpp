@@ -0,0 +1,206 @@
+/**
+* @file AlpLedTelemetry.cpp
+*
+* @brief Background LED telemetry, see AlpLedTelemetry.h.
+*
+* The ring holds `ringSize` samples; the sampler owns `_head` and the consumer `_tail`, both
+* counting samples since start(). A slot is written before `_head` is released and read
+* before `_tail` is released, so neither side ever touches a slot the other one uses.
+*/
+
+#include "AlpLedTelemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+AlpLedTelemetry::AlpLedTelemetry()
+	: _deviceId(ALP_INVALID_ID), _ledId(ALP_INVALID_ID), _rate(0), _ring(ringSize), _head(0), _tail(0),
+	_samples(0), _dropped(0), _result(ALP_OK), _latestVersion(0), _latestTime(0), _latestCurrent(0),
+	_latestJunctionTemp(0), _logFile(nullptr), _csv(false), _stop(false), _logStop(false) {
+}
+
+AlpLedTelemetry::~AlpLedTelemetry() {
+	stop();
+}
+
+/**
+* @brief Starts sampling an allocated LED, and logging if `logPath` is given.
+*
+* @param rate Samples per second, 1 to 1000. Every sample costs two LED inquiries.
+* @param logPath File to append the samples to; empty to consume them with read() instead.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int AlpLedTelemetry::start(const ALP_ID deviceId, const ALP_ID ledId, const unsigned long rate, const std::filesystem::path& logPath) {
+	if (running()) {
+		std::cerr << "Error: Telemetry has already been started." << std::endl;
+		return 1;
+	}
+	if (rate < 1 || rate > 1000) {
+		std::cerr << "Error: The telemetry rate must be 1 to 1000 samples per second." << std::endl;
+		return 1;
+	}
+	if (!logPath.empty()) {
+		_logFile = std::fopen(logPath.string().c_str(), "ab");
+		if (_logFile == nullptr) {
+			std::cerr << "Error: Cannot open " << logPath.string() << " for appending." << std::endl;
+			return 1;
+		}
+		_csv = logPath.extension() == ".csv";
+		std::fseek(_logFile, 0, SEEK_END);
+		if (_csv && std::ftell(_logFile) == 0)
+			std::fprintf(_logFile, "time_ns,current_mA,junction_temp_degC\n");
+	}
+
+	_deviceId = deviceId, _ledId = ledId, _rate = rate;
+	_head = 0, _tail = 0, _samples = 0, _dropped = 0, _result = ALP_OK, _latestVersion = 0;
+	_stop = false, _logStop = false;
+	_sampler = std::thread(&AlpLedTelemetry::sample, this);
+	if (_logFile != nullptr)
+		_logger = std::thread(&AlpLedTelemetry::log, this);
+	return 0;
+}
+
+/**
+* @brief Stops sampling, writes the remaining samples to the log and closes it.
+*/
+void AlpLedTelemetry::stop() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_stopRequested.notify_all();
+	if (_sampler.joinable())
+		_sampler.join();
+	// the logger writes the last samples once the sampler has finished
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_logStop = true;
+	}
+	_stopRequested.notify_all();
+	if (_logger.joinable())
+		_logger.join();
+	if (_logFile != nullptr) {
+		std::fclose(_logFile);
+		_logFile = nullptr;
+	}
+}
+
+bool AlpLedTelemetry::running() const {
+	return _sampler.joinable();
+}
+
+/**
+* @brief Reads the most recent sample without blocking.
+*
+* @return bool, false if no sample has been taken yet.
+*/
+bool AlpLedTelemetry::latest(tAlpLedSample& sample) const {
+	for (;;) {
+		unsigned long long const version = _latestVersion.load(std::memory_order_acquire);
+		if (version == 0)
+			return false;
+		if (version % 2 != 0)
+			continue;
+		sample.Time = _latestTime.load(std::memory_order_relaxed);
+		sample.Current = _latestCurrent.load(std::memory_order_relaxed);
+		sample.JunctionTemp = _latestJunctionTemp.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (_latestVersion.load(std::memory_order_relaxed) == version)
+			return true;
+	}
+}
+
+/**
+* @brief Takes up to `maxCount` samples from the ring, oldest first. Only without a log file,
+* and from a single thread.
+*
+* @return size_t, the number of samples copied to `samples`.
+*/
+size_t AlpLedTelemetry::read(tAlpLedSample* samples, const size_t maxCount) {
+	unsigned long long const tail = _tail.load(std::memory_order_relaxed);
+	unsigned long long const head = _head.load(std::memory_order_acquire);
+	size_t const count = (size_t)std::min<unsigned long long>(head - tail, maxCount);
+	for (size_t i = 0; i < count; i++)
+		samples[i] = _ring[(tail + i) % ringSize];
+	_tail.store(tail + count, std::memory_order_release);
+	return count;
+}
+
+// Samples taken since start
+unsigned long long AlpLedTelemetry::sampleCount() const {
+	return _samples;
+}
+
+// Samples not stored in the ring because the consumer fell behind
+unsigned long long AlpLedTelemetry::droppedCount() const {
+	return _dropped;
+}
+
+// ALP_OK, or the error code of the inquiry that stopped the sampling
+long AlpLedTelemetry::result() const {
+	return _result;
+}
+
+void AlpLedTelemetry::sample() {
+	typedef std::chrono::steady_clock Clock;
+	auto const period = std::chrono::nanoseconds(1000000000LL / _rate);
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (auto next = Clock::now(); !_stop; next += period) {
+		lock.unlock();
+		tAlpLedSample sample = { 0, 0, 0 };
+		long result = AlpLedInquire(_deviceId, _ledId, ALP_LED_MEASURED_CURRENT, &sample.Current);
+		if (result == ALP_OK)
+			result = AlpLedInquire(_deviceId, _ledId, ALP_LED_TEMPERATURE_JUNCTION, &sample.JunctionTemp);
+		sample.Time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+		lock.lock();
+		if (result != ALP_OK) {
+			_result = result;
+			break;
+		}
+
+		unsigned long long const version = _latestVersion.load(std::memory_order_relaxed);
+		_latestVersion.store(version + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		_latestTime.store(sample.Time, std::memory_order_relaxed);
+		_latestCurrent.store(sample.Current, std::memory_order_relaxed);
+		_latestJunctionTemp.store(sample.JunctionTemp, std::memory_order_relaxed);
+		_latestVersion.store(version + 2, std::memory_order_release);
+
+		unsigned long long const head = _head.load(std::memory_order_relaxed);
+		if (head - _tail.load(std::memory_order_acquire) < ringSize) {
+			_ring[head % ringSize] = sample;
+			_head.store(head + 1, std::memory_order_release);
+		}
+		else
+			_dropped++;
+		_samples++;
+
+		_stopRequested.wait_until(lock, next + period, [this] { return _stop; });
+	}
+}
+
+// Appends the ring's samples to the log file every 100 ms, and once more after sampling stopped
+void AlpLedTelemetry::log() {
+	std::vector<tAlpLedSample> batch(ringSize);
+	for (bool stopping = false; ; ) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			stopping = _stopRequested.wait_for(lock, std::chrono::milliseconds(100), [this] { return _logStop; });
+		}
+		for (size_t count; (count = read(batch.data(), batch.size())) > 0; )
+			writeSamples(batch.data(), count);
+		std::fflush(_logFile);
+		if (stopping)
+			return;
+	}
+}
+
+void AlpLedTelemetry::writeSamples(tAlpLedSample const* samples, const size_t count) {
+	if (!_csv) {
+		std::fwrite(samples, sizeof(tAlpLedSample), count, _logFile);
+		return;
+	}
+	for (size_t i = 0; i < count; i++)
+		std::fprintf(_logFile, "%lld,%ld,%.3f\n", samples[i].Time, samples[i].Current, samples[i].JunctionTemp / 256.);
+}
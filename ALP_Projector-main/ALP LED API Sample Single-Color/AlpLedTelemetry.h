@@ -0,0 +1,94 @@
+#pragma once
+
+/**
+* @file AlpLedTelemetry.h
+*
+* @brief Samples the LED current and junction temperature on a background thread.
+*
+* A sampling thread inquires ALP_LED_MEASURED_CURRENT and ALP_LED_TEMPERATURE_JUNCTION at a
+* fixed rate and publishes every sample twice:
+*
+* - as the latest value, which latest() reads without locking or blocking, so control code
+*   (e.g. Projector::display) never waits for the USB round trip of an inquiry;
+* - into a lock-free single-producer/single-consumer ring, drained either by a log thread
+*   appending to a file, or by the caller through read(). If the consumer falls behind, new
+*   samples are dropped (and counted) instead of blocking the sampler.
+*
+* Log files are opened for appending. A path ending in ".csv" gets text lines
+* "time_ns,current_mA,junction_temp_degC", any other path raw tAlpLedSample records.
+*
+* Usage:
+*
+*	AlpLedTelemetry telemetry;
+*	telemetry.start(deviceId, ledId, 100, "led.csv");
+*	...
+*	tAlpLedSample sample;
+*	if (telemetry.latest(sample)) ...
+*	telemetry.stop();
+*/
+
+#include "stdafx.h"
+#include "alp.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* @brief One telemetry sample, also the record of binary log files.
+*/
+struct tAlpLedSample {
+	long long Time;				/* [ns] std::chrono::steady_clock, comparable across threads */
+	long Current;				/* [mA] ALP_LED_MEASURED_CURRENT */
+	long JunctionTemp;			/* [1/256 degC] ALP_LED_TEMPERATURE_JUNCTION */
+};
+
+class AlpLedTelemetry {
+public:
+	AlpLedTelemetry();
+	~AlpLedTelemetry();
+
+	AlpLedTelemetry(const AlpLedTelemetry&) = delete;
+	AlpLedTelemetry& operator=(const AlpLedTelemetry&) = delete;
+
+	int start(const ALP_ID deviceId, const ALP_ID ledId, const unsigned long rate, const std::filesystem::path& logPath = {});
+	void stop();
+	bool running() const;
+
+	bool latest(tAlpLedSample& sample) const;
+	size_t read(tAlpLedSample* samples, const size_t maxCount);
+
+	unsigned long long sampleCount() const;
+	unsigned long long droppedCount() const;
+	long result() const;
+
+private:
+	void sample();
+	void log();
+	void writeSamples(tAlpLedSample const* samples, const size_t count);
+
+	// power of two, 40 s at 100 Hz
+	static const size_t ringSize = 4096;
+
+	ALP_ID _deviceId, _ledId;
+	unsigned long _rate;
+
+	std::vector<tAlpLedSample> _ring;
+	std::atomic<unsigned long long> _head, _tail;
+	std::atomic<unsigned long long> _samples, _dropped;
+	std::atomic<long> _result;
+
+	// seqlock: odd while the latest sample is being written
+	std::atomic<unsigned long long> _latestVersion;
+	std::atomic<long long> _latestTime;
+	std::atomic<long> _latestCurrent, _latestJunctionTemp;
+
+	std::FILE* _logFile;
+	bool _csv, _stop, _logStop;
+	std::mutex _mutex;
+	std::condition_variable _stopRequested;
+	std::thread _sampler, _logger;
+};
@@ -0,0 +1,370 @@
+/**
+* @file AlpPack.cpp
+*
+* @brief Gray8 to packed binary conversion with runtime CPU dispatch, see AlpPack.h.
+*
+* The SIMD kernels compare 16 or 32 pixels at once and collect the results with
+* movemask, which yields one bit per pixel with the leftmost pixel in bit 0. The ALP
+* wants the leftmost pixel in bit 7, so SSE2 reverses each mask byte with a lookup
+* table, while AVX2 reverses the pixel order within each group of 8 beforehand.
+*
+* Slicing uses the same collection step: movemask takes bit 7 of every pixel, and adding
+* the pixels to themselves moves the next bit up, one plane per step. The scalar kernel
+* transposes 8x8 bit blocks held in a 64-bit word instead.
+*
+* Comparing two rows (AlpCompareRow) packs the mask of the saturated difference a - b, so
+* it collects "a > b" the same way, and keeps the absolute difference for the contrast.
+*/
+
+#include "AlpPack.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define ALP_PACK_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ALP_TARGET_SSE2
+#define ALP_TARGET_AVX2
+#else
+#define ALP_TARGET_SSE2 __attribute__((target("sse2")))
+#define ALP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+typedef void (*PackFunction)(const uint8_t*, uint8_t*, long, uint8_t);
+typedef void (*SliceFunction)(const uint8_t*, uint8_t* const*, long, long);
+typedef void (*CompareFunction)(const uint8_t*, const uint8_t*, uint8_t*, uint8_t*, long);
+
+struct ReverseTable {
+	uint8_t bits[256];
+	ReverseTable() {
+		for (int i = 0; i < 256; i++) {
+			uint8_t reversed = 0;
+			for (int bit = 0; bit < 8; bit++)
+				if (i & (1 << bit))
+					reversed |= (uint8_t)(0x80 >> bit);
+			bits[i] = reversed;
+		}
+	}
+};
+const ReverseTable gReverse;
+
+// Remaining pixels (fewer than a full SIMD step), including a partial last byte
+void PackTail(const uint8_t* gray, uint8_t* packed, long width, uint8_t threshold) {
+	for (long x = 0; x < width; x += 8) {
+		uint8_t byte = 0;
+		for (long bit = 0; bit < 8; bit++)
+			if (x + bit < width && gray[x + bit] >= threshold)
+				byte |= (uint8_t)(0x80 >> bit);
+		*packed++ = byte;
+	}
+}
+
+void PackScalar(const uint8_t* gray, uint8_t* packed, long width, uint8_t threshold) {
+	long x = 0;
+	for (; x + 8 <= width; x += 8) {
+		uint8_t byte = 0;
+		for (long bit = 0; bit < 8; bit++)
+			byte = (uint8_t)((byte << 1) | (gray[x + bit] >= threshold));
+		*packed++ = byte;
+	}
+	PackTail(gray + x, packed, width - x, threshold);
+}
+
+// Remaining pixels of a slice; `offset` is the byte of the plane rows the pixels start at
+void SliceTail(const uint8_t* gray, uint8_t* const* planes, long width, long planeCount, long offset) {
+	for (long x = 0; x < width; x += 8)
+		for (long k = 0; k < planeCount; k++) {
+			uint8_t byte = 0;
+			for (long bit = 0; bit < 8; bit++)
+				if (x + bit < width && (gray[x + bit] & (0x80 >> k)) != 0)
+					byte |= (uint8_t)(0x80 >> bit);
+			planes[k][offset + x / 8] = byte;
+		}
+}
+
+// Transposes an 8x8 bit matrix, row i in byte 7 - i, column j in bit 7 - j of each byte
+uint64_t Transpose8x8(uint64_t x) {
+	uint64_t t;
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	return x ^ t ^ (t << 28);
+}
+
+void SliceScalar(const uint8_t* gray, uint8_t* const* planes, long width, long planeCount) {
+	long x = 0;
+	for (; x + 8 <= width; x += 8) {
+		uint64_t block = 0;
+		for (long i = 0; i < 8; i++)
+			block = (block << 8) | gray[x + i];
+		block = Transpose8x8(block);
+		for (long k = 0; k < planeCount; k++)
+			planes[k][x / 8] = (uint8_t)(block >> (56 - 8 * k));
+	}
+	SliceTail(gray + x, planes, width - x, planeCount, x / 8);
+}
+
+// Remaining pixels of a comparison, including a partial last byte
+void CompareTail(const uint8_t* a, const uint8_t* b, uint8_t* packed, uint8_t* minDifference, long width) {
+	for (long x = 0; x < width; x += 8) {
+		uint8_t byte = 0;
+		for (long bit = 0; bit < 8 && x + bit < width; bit++) {
+			uint8_t const pa = a[x + bit], pb = b[x + bit];
+			uint8_t const difference = pa > pb ? (uint8_t)(pa - pb) : (uint8_t)(pb - pa);
+			if (pa > pb)
+				byte |= (uint8_t)(0x80 >> bit);
+			if (difference < minDifference[x + bit])
+				minDifference[x + bit] = difference;
+		}
+		*packed++ = byte;
+	}
+}
+
+void CompareScalar(const uint8_t* a, const uint8_t* b, uint8_t* packed, uint8_t* minDifference, long width) {
+	CompareTail(a, b, packed, minDifference, width);
+}
+
+#ifdef ALP_PACK_X86
+ALP_TARGET_SSE2 void PackSSE2(const uint8_t* gray, uint8_t* packed, long width, uint8_t threshold) {
+	__m128i const limit = _mm_set1_epi8((char)threshold);
+	long x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i const pixels = _mm_loadu_si128((const __m128i*)(gray + x));
+		// unsigned pixels >= threshold  <=>  max(pixels, threshold) == pixels
+		__m128i const on = _mm_cmpeq_epi8(_mm_max_epu8(pixels, limit), pixels);
+		int const mask = _mm_movemask_epi8(on);
+		*packed++ = gReverse.bits[mask & 0xFF];
+		*packed++ = gReverse.bits[(mask >> 8) & 0xFF];
+	}
+	PackTail(gray + x, packed, width - x, threshold);
+}
+
+ALP_TARGET_AVX2 void PackAVX2(const uint8_t* gray, uint8_t* packed, long width, uint8_t threshold) {
+	__m256i const limit = _mm256_set1_epi8((char)threshold);
+	__m256i const reverse = _mm256_setr_epi8(
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	long x = 0;
+	for (; x + 32 <= width; x += 32) {
+		__m256i const pixels = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(gray + x)), reverse);
+		__m256i const on = _mm256_cmpeq_epi8(_mm256_max_epu8(pixels, limit), pixels);
+		uint32_t const mask = (uint32_t)_mm256_movemask_epi8(on);
+		memcpy(packed, &mask, sizeof(mask));	// little endian: pixels 0..7 end up in the first byte
+		packed += sizeof(mask);
+	}
+	// Leave the upper register halves clean, legacy SSE code after this would otherwise stall
+	_mm256_zeroupper();
+	PackTail(gray + x, packed, width - x, threshold);
+}
+
+ALP_TARGET_SSE2 void CompareSSE2(const uint8_t* a, const uint8_t* b, uint8_t* packed, uint8_t* minDifference, long width) {
+	__m128i const zero = _mm_setzero_si128();
+	long x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i const pa = _mm_loadu_si128((const __m128i*)(a + x)), pb = _mm_loadu_si128((const __m128i*)(b + x));
+		__m128i const up = _mm_subs_epu8(pa, pb), down = _mm_subs_epu8(pb, pa);
+		int const mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(up, zero));
+		*packed++ = gReverse.bits[mask & 0xFF];
+		*packed++ = gReverse.bits[(mask >> 8) & 0xFF];
+		__m128i* const min = (__m128i*)(minDifference + x);
+		_mm_storeu_si128(min, _mm_min_epu8(_mm_loadu_si128(min), _mm_or_si128(up, down)));
+	}
+	CompareTail(a + x, b + x, packed, minDifference + x, width - x);
+}
+
+ALP_TARGET_AVX2 void CompareAVX2(const uint8_t* a, const uint8_t* b, uint8_t* packed, uint8_t* minDifference, long width) {
+	__m256i const zero = _mm256_setzero_si256();
+	__m256i const reverse = _mm256_setr_epi8(
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	long x = 0;
+	for (; x + 32 <= width; x += 32) {
+		__m256i const pa = _mm256_loadu_si256((const __m256i*)(a + x)), pb = _mm256_loadu_si256((const __m256i*)(b + x));
+		__m256i const up = _mm256_subs_epu8(pa, pb), down = _mm256_subs_epu8(pb, pa);
+		uint32_t const mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(up, reverse), zero));
+		memcpy(packed, &mask, sizeof(mask));
+		packed += sizeof(mask);
+		__m256i* const min = (__m256i*)(minDifference + x);
+		_mm256_storeu_si256(min, _mm256_min_epu8(_mm256_loadu_si256(min), _mm256_or_si256(up, down)));
+	}
+	_mm256_zeroupper();
+	CompareTail(a + x, b + x, packed, minDifference + x, width - x);
+}
+
+ALP_TARGET_SSE2 void SliceSSE2(const uint8_t* gray, uint8_t* const* planes, long width, long planeCount) {
+	long x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(gray + x));
+		for (long k = 0; k < planeCount; k++) {
+			int const mask = _mm_movemask_epi8(pixels);
+			planes[k][x / 8] = gReverse.bits[mask & 0xFF];
+			planes[k][x / 8 + 1] = gReverse.bits[(mask >> 8) & 0xFF];
+			pixels = _mm_add_epi8(pixels, pixels);
+		}
+	}
+	SliceTail(gray + x, planes, width - x, planeCount, x / 8);
+}
+
+ALP_TARGET_AVX2 void SliceAVX2(const uint8_t* gray, uint8_t* const* planes, long width, long planeCount) {
+	__m256i const reverse = _mm256_setr_epi8(
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	long x = 0;
+	for (; x + 32 <= width; x += 32) {
+		__m256i pixels = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(gray + x)), reverse);
+		for (long k = 0; k < planeCount; k++) {
+			uint32_t const mask = (uint32_t)_mm256_movemask_epi8(pixels);
+			memcpy(planes[k] + x / 8, &mask, sizeof(mask));
+			pixels = _mm256_add_epi8(pixels, pixels);
+		}
+	}
+	_mm256_zeroupper();
+	SliceTail(gray + x, planes, width - x, planeCount, x / 8);
+}
+#endif
+
+bool Supported(AlpPackKernel kernel) {
+	switch (kernel) {
+	case AlpPackKernel::Scalar:
+		return true;
+#ifdef ALP_PACK_X86
+#ifdef _MSC_VER
+	case AlpPackKernel::SSE2: {
+		int info[4];
+		__cpuid(info, 1);
+		return (info[3] & (1 << 26)) != 0;
+	}
+	case AlpPackKernel::AVX2: {
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		bool const osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}
+#else
+	case AlpPackKernel::SSE2:
+		return __builtin_cpu_supports("sse2");
+	case AlpPackKernel::AVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+#endif
+	default:
+		return false;
+	}
+}
+
+PackFunction Function(AlpPackKernel kernel) {
+	switch (kernel) {
+#ifdef ALP_PACK_X86
+	case AlpPackKernel::SSE2: return PackSSE2;
+	case AlpPackKernel::AVX2: return PackAVX2;
+#endif
+	default: return PackScalar;
+	}
+}
+
+SliceFunction SliceFunctionOf(AlpPackKernel kernel) {
+	switch (kernel) {
+#ifdef ALP_PACK_X86
+	case AlpPackKernel::SSE2: return SliceSSE2;
+	case AlpPackKernel::AVX2: return SliceAVX2;
+#endif
+	default: return SliceScalar;
+	}
+}
+
+CompareFunction CompareFunctionOf(AlpPackKernel kernel) {
+	switch (kernel) {
+#ifdef ALP_PACK_X86
+	case AlpPackKernel::SSE2: return CompareSSE2;
+	case AlpPackKernel::AVX2: return CompareAVX2;
+#endif
+	default: return CompareScalar;
+	}
+}
+
+AlpPackKernel BestKernel() {
+	if (Supported(AlpPackKernel::AVX2))
+		return AlpPackKernel::AVX2;
+	if (Supported(AlpPackKernel::SSE2))
+		return AlpPackKernel::SSE2;
+	return AlpPackKernel::Scalar;
+}
+
+AlpPackKernel gKernel = BestKernel();
+PackFunction gPack = Function(gKernel);
+SliceFunction gSlice = SliceFunctionOf(gKernel);
+CompareFunction gCompare = CompareFunctionOf(gKernel);
+
+}
+
+/**
+* @brief Thresholds `width` gray pixels and packs them, 8 per byte, MSB leftmost.
+*
+* @param gray Source pixels, one byte each.
+* @param packed Destination, receives (width + 7) / 8 bytes.
+* @param width Number of pixels.
+* @param threshold Pixels greater than or equal to this value are switched on.
+*/
+void AlpPackRow(const char unsigned* gray, char unsigned* packed, const long width, const char unsigned threshold) {
+	gPack(gray, packed, width, threshold);
+}
+
+/**
+* @brief Splits `width` gray pixels into their `planeCount` most significant bit planes, packed.
+*
+* @param gray Source pixels, one byte each.
+* @param planes `planeCount` destination rows, each receives (width + 7) / 8 bytes; planes[0]
+* holds bit 7 (the most significant bit) of every pixel.
+* @param width Number of pixels.
+* @param planeCount Number of planes, 1 to 8.
+*/
+void AlpSliceRow(const char unsigned* gray, char unsigned* const* planes, const long width, const long planeCount) {
+	gSlice(gray, planes, width, planeCount);
+}
+
+/**
+* @brief Compares two gray rows pixel by pixel and packs the results, e.g. a pattern and its inverse.
+*
+* @param a, b Source pixels, one byte each.
+* @param packed Destination, receives (width + 7) / 8 bytes; a bit is set where a > b.
+* @param minDifference `width` bytes, each lowered to |a - b| where that is smaller.
+* @param width Number of pixels.
+*/
+void AlpCompareRow(const char unsigned* a, const char unsigned* b, char unsigned* packed, char unsigned* minDifference, const long width) {
+	gCompare(a, b, packed, minDifference, width);
+}
+
+AlpPackKernel AlpPackActiveKernel() {
+	return gKernel;
+}
+
+bool AlpPackSelectKernel(const AlpPackKernel kernel) {
+	if (!Supported(kernel))
+		return false;
+	gKernel = kernel;
+	gPack = Function(kernel);
+	gSlice = SliceFunctionOf(kernel);
+	gCompare = CompareFunctionOf(kernel);
+	return true;
+}
+
+const char* AlpPackKernelName(const AlpPackKernel kernel) {
+	switch (kernel) {
+	case AlpPackKernel::SSE2: return "SSE2";
+	case AlpPackKernel::AVX2: return "AVX2";
+	default: return "Scalar";
+	}
+}
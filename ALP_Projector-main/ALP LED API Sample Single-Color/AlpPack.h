@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+* @file AlpPack.h
+*
+* @brief Threshold 8-bit gray pixels and pack them into the ALP's binary format.
+*
+* A pixel is switched on if it is greater than or equal to the threshold. Eight
+* pixels form one byte, bit 7 holding the leftmost pixel (ALP_DATA_BINARY_TOPDOWN).
+*
+* Gray pixels can also be sliced into bit planes, each packed the same way. This is
+* an 8x8 bit transpose per group of 8 pixels: 8 bytes of 8 bits become 8 plane bytes.
+*
+* Two gray rows can also be compared pixel by pixel, packing where the first is brighter,
+* e.g. a structured-light capture and the capture of its inverse pattern.
+*
+* The kernel is selected at runtime from the instruction sets the CPU supports:
+* AVX2 (32 pixels per step), SSE2 (16 pixels per step) or portable scalar code.
+*/
+
+enum class AlpPackKernel { Scalar, SSE2, AVX2 };
+
+// Pack `width` pixels; writes (width + 7) / 8 bytes, a partial last byte is padded with zeros.
+void AlpPackRow(const char unsigned* gray, char unsigned* packed, const long width, const char unsigned threshold);
+
+// Slice `width` pixels into `planeCount` packed rows: planes[0] receives bit 7 of each pixel,
+// planes[k] bit 7 - k. Each row receives (width + 7) / 8 bytes, padded like AlpPackRow.
+void AlpSliceRow(const char unsigned* gray, char unsigned* const* planes, const long width, const long planeCount);
+
+// Pack `width` comparisons a > b like AlpPackRow, and lower minDifference[x] to |a[x] - b[x]| where smaller.
+void AlpCompareRow(const char unsigned* a, const char unsigned* b, char unsigned* packed, char unsigned* minDifference, const long width);
+
+// The kernel used by AlpPackRow, AlpSliceRow and AlpCompareRow
+AlpPackKernel AlpPackActiveKernel();
+
+// Force a kernel, e.g. for benchmarking. Returns false if the CPU does not support it.
+bool AlpPackSelectKernel(const AlpPackKernel kernel);
+
+const char* AlpPackKernelName(const AlpPackKernel kernel);
@@ -0,0 +1,236 @@
+/**
+* @file AlpPatternDecoder.cpp
+*
+* @brief Structured-light decoding and synthetic captures, see AlpPatternDecoder.h.
+*
+* Per band every thread keeps the minimum contrast of one row, a packed row per Gray-code bit
+* and the codes of one row, so the working set stays in the L1/L2 cache however large the
+* captures are.
+*/
+
+#include "AlpPatternDecoder.h"
+#include "AlpPack.h"
+#include "AlpThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// Transposes an 8x8 bit matrix whose row r is byte 7 - r, column 0 being the most significant bit
+uint64_t Transpose8x8(uint64_t x) {
+	uint64_t t;
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL; x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL; x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL; x ^= t ^ (t << 28);
+	return x;
+}
+
+// Angle of (x, y) in [0, 2 pi) within 2e-4 rad, a thousandth of a pixel at a period of 32;
+// std::atan2 would take longer than all other steps of the decode together
+float Phase(const float y, const float x) {
+	float const ax = std::abs(x), ay = std::abs(y);
+	float const a = std::min(ax, ay) / std::max(std::max(ax, ay), 1e-30f), s = a * a;
+	float angle = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+	if (ay > ax)
+		angle = (float)(pi / 2) - angle;
+	if (x < 0)
+		angle = (float)pi - angle;
+	return y < 0 ? (float)(2 * pi) - angle : angle;
+}
+
+// Pseudo-random value in [-1, 1) from a pixel and frame index
+double Hash(uint64_t key) {
+	key ^= key >> 33; key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33; key *= 0xC4CEB9FE1A85EC53ULL;
+	key ^= key >> 33;
+	return (double)(key >> 11) / (double)(1ULL << 52) - 1.;
+}
+
+}
+
+/**
+* @brief Decodes one axis of a capture stack into projector positions.
+*
+* @param captures Gray8 captures, one frame per projected pattern, at the camera resolution.
+* @param set Where the patterns of the axis are in `captures`.
+* @param positions Receives one value per camera pixel, row by row: the projector column (or
+* row) seen, in projector pixels with pixel centres at integers, or -1 where the contrast is
+* too low. Without phase shift the position is the centre of the pixels in the decoded stripe.
+* @param stats Receives the pixel counts and the decode time.
+* @param minContrast Gray levels a pattern and its inverse must differ by in every bit (and
+* the peak-to-peak amplitude of the phase-shift sinusoid) for a pixel to be valid.
+*
+* @return int, 0 on success, otherwise 1 if the captures are not gray8 or the set does not fit them.
+*/
+int AlpDecodePatterns(AlpFrames& captures, tAlpPatternSet const& set, std::vector<float>& positions,
+	tAlpDecodeStats& stats, const long minContrast) {
+	bool const phase = set.PhaseFrame >= 0;
+	if (captures._format != AlpFrames::PixelFormat::Gray8) {
+		std::cerr << "Error: Captures must be gray8 frames." << std::endl;
+		return 1;
+	}
+	if (set.Bits < 1 || set.Bits > 24 || set.Size < 1 || set.GrayFrame < 0 || set.GrayFrame + 2 * set.Bits > captures._frameCount
+		|| (phase && (set.Steps < 3 || set.Period < 2 || set.PhaseFrame + set.Steps > captures._frameCount))) {
+		std::cerr << "Error: Pattern set does not fit the captures." << std::endl;
+		return 1;
+	}
+
+	auto const start = std::chrono::steady_clock::now();
+	long const width = captures._width, height = captures._height, packedBytes = (width + 7) / 8;
+	long const bits = set.Bits, steps = phase ? set.Steps : 0;
+	double const period = set.Period;
+	float const contrast = (float)minContrast;
+	std::vector<float> cosines(steps), sines(steps);
+	for (long n = 0; n < steps; n++) {
+		cosines[n] = (float)std::cos(2 * pi * n / steps);
+		sines[n] = (float)std::sin(2 * pi * n / steps);
+	}
+	positions.assign((size_t)width * height, -1.f);
+	std::atomic<unsigned long long> valid(0);
+
+	AlpThreadPool& pool = AlpThreadPool::shared();
+	long const band = std::max(1L, height / (long)(4 * pool.concurrency()));
+	pool.parallelFor(0, height, [&](long first, long last) {
+		std::vector<char unsigned> minDifference(width);
+		std::vector<char unsigned> planes((size_t)bits * packedBytes);
+		std::vector<uint32_t> codes((size_t)packedBytes * 8);
+		std::vector<char unsigned const*> phaseRows(steps);
+		unsigned long long bandValid = 0;
+
+		for (long y = first; y < last; y++) {
+			// threshold every pattern against its inverse and pack the results
+			std::fill(minDifference.begin(), minDifference.end(), (char unsigned)255);
+			for (long k = 0; k < bits; k++)
+				AlpCompareRow(captures.row(set.GrayFrame + 2 * k, y), captures.row(set.GrayFrame + 2 * k + 1, y),
+					&planes[(size_t)k * packedBytes], minDifference.data(), width);
+
+			// gather the bits of 8 pixels from up to 8 planes at once
+			std::fill(codes.begin(), codes.end(), 0u);
+			for (long k0 = 0; k0 < bits; k0 += 8) {
+				long const planeCount = std::min(8L, bits - k0);
+				for (long group = 0; group < packedBytes; group++) {
+					uint64_t matrix = 0;
+					for (long k = 0; k < planeCount; k++)
+						matrix |= (uint64_t)planes[(size_t)(k0 + k) * packedBytes + group] << (56 - 8 * k);
+					matrix = Transpose8x8(matrix);
+					uint32_t* const code = &codes[(size_t)group * 8];
+					for (long j = 0; j < 8; j++)
+						code[j] = code[j] << planeCount | (uint32_t)(matrix >> (56 - 8 * j) & 0xFF) >> (8 - planeCount);
+				}
+			}
+
+			for (long n = 0; n < steps; n++)
+				phaseRows[n] = captures.row(set.PhaseFrame + n, y);
+
+			float* const row = &positions[(size_t)y * width];
+			for (long x = 0; x < width; x++) {
+				if (minDifference[x] < contrast)
+					continue;
+				uint32_t stripe = codes[x];
+				for (int shift = 1; shift < 32; shift <<= 1)
+					stripe ^= stripe >> shift;
+				// centre of the projector pixels i with i * 2^bits / size == stripe
+				long long const firstPixel = ((long long)stripe * set.Size + (1LL << bits) - 1) >> bits;
+				long long const lastPixel = ((((long long)stripe + 1) * set.Size + (1LL << bits) - 1) >> bits) - 1;
+				double position = (firstPixel + lastPixel) / 2.;
+				if (phase) {
+					// the usual 4-step set reduces to differences of opposite patterns
+					float sinSum = 0, cosSum = 0;
+					if (steps == 4) {
+						sinSum = (float)(phaseRows[1][x] - phaseRows[3][x]);
+						cosSum = (float)(phaseRows[0][x] - phaseRows[2][x]);
+					}
+					else
+						for (long n = 0; n < steps; n++) {
+							sinSum += phaseRows[n][x] * sines[n];
+							cosSum += phaseRows[n][x] * cosines[n];
+						}
+					// peak-to-peak amplitude of the sinusoid: 4 / steps * |sum I_n e^(i 2 pi n / steps)|
+					if (16.f / (steps * steps) * (sinSum * sinSum + cosSum * cosSum) < contrast * contrast)
+						continue;
+					double const offset = Phase(sinSum, cosSum) / (2 * pi) * period;
+					position = std::floor((position - offset) / period + 0.5) * period + offset;
+				}
+				row[x] = (float)position;
+				bandValid++;
+			}
+		}
+		valid += bandValid;
+	}, band);
+
+	stats.Pixels = (unsigned long long)width * height;
+	stats.Valid = valid;
+	stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.MegapixelsPerSecond = stats.Pixels / std::max(stats.Seconds, 1e-9) / 1e6;
+	return 0;
+}
+
+// Projector position seen by camera pixel (u, v) of a `cameraWidth` x `cameraHeight` image of `scene`
+void AlpSceneToProjector(tAlpSyntheticScene const& scene, const long cameraWidth, const long cameraHeight,
+	const double u, const double v, double& x, double& y) {
+	double const du = (u - cameraWidth / 2.) / (cameraWidth / 2.), dv = (v - cameraHeight / 2.) / (cameraHeight / 2.);
+	x = scene.OffsetX + scene.Scale * u + scene.Bump * std::max(0., 1. - du * du - dv * dv);
+	y = scene.OffsetY + scene.Scale * v;
+}
+
+/**
+* @brief Renders what a camera sees of every pattern projected onto `scene`.
+*
+* @param patterns Gray8 patterns at the projector resolution.
+* @param captures Gray8 frames at the camera resolution, one per pattern, which receive
+* Ambient + Contrast * pattern / 255 + noise, the pattern sampled bilinearly at the projector
+* position of every camera pixel (AlpSceneToProjector), or unlit outside the projector.
+*
+* The optics are not blurred, so dithered binary patterns would alias; draw the synthetic
+* patterns as gray8 frames instead. The frames are rendered in parallel (renderFrames).
+*
+* @return int, 0 on success, otherwise 1 if the formats or frame counts do not match.
+*/
+int AlpSynthesizeCaptures(AlpFrames& patterns, AlpFrames& captures, tAlpSyntheticScene const& scene) {
+	if (patterns._format != AlpFrames::PixelFormat::Gray8 || captures._format != AlpFrames::PixelFormat::Gray8
+		|| captures._frameCount < patterns._frameCount) {
+		std::cerr << "Error: Synthetic captures need gray8 patterns and a gray8 capture per pattern." << std::endl;
+		return 1;
+	}
+
+	struct Sample {
+		long index;		// top-left projector pixel, or -1 outside the projector
+		float fx, fy;	// bilinear weights of the right and bottom pixels
+	};
+	long const width = captures._width, height = captures._height;
+	std::vector<Sample> samples((size_t)width * height);
+	for (long v = 0; v < height; v++)
+		for (long u = 0; u < width; u++) {
+			double x, y;
+			AlpSceneToProjector(scene, width, height, u, v, x, y);
+			double const x0 = std::floor(x), y0 = std::floor(y);
+			bool const inside = x0 >= 0 && y0 >= 0 && x0 + 1 < patterns._width && y0 + 1 < patterns._height;
+			samples[(size_t)v * width + u] = Sample{ inside ? (long)y0 * patterns._rowBytes + (long)x0 : -1,
+				(float)(x - x0), (float)(y - y0) };
+		}
+
+	return captures.renderFrames(0, patterns._frameCount, [&](AlpFrames& capture, long frameNum) {
+		char unsigned const* const pattern = patterns(frameNum);
+		long const rowBytes = patterns._rowBytes;
+		for (long v = 0; v < height; v++) {
+			char unsigned* const row = capture.row(0, v);
+			for (long u = 0; u < width; u++) {
+				size_t const i = (size_t)v * width + u;
+				Sample const& s = samples[i];
+				double lit = 0;
+				if (s.index >= 0) {
+					char unsigned const* const p = pattern + s.index;
+					lit = ((p[0] * (1 - s.fx) + p[1] * s.fx) * (1 - s.fy) + (p[rowBytes] * (1 - s.fx) + p[rowBytes + 1] * s.fx) * s.fy) / 255.;
+				}
+				double const value = scene.Ambient + scene.Contrast * lit + scene.Noise * Hash((uint64_t)frameNum << 40 | i);
+				row[u] = (char unsigned)std::clamp(std::lround(value), 0L, 255L);
+			}
+		}
+	});
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/**
+* @file AlpPatternDecoder.h
+*
+* @brief Decodes camera captures of structured-light patterns into projector columns or rows.
+*
+* The counterpart of AlpFrames::drawGrayCode and drawPhaseShift: a camera captures every
+* projected pattern into a gray8 frame, and for each camera pixel the decoder recovers the
+* projector column (or row) that lit it.
+*
+* - Gray code: every pattern is compared with its inverse and the comparisons of a row are
+*   packed to one bit per pixel with AlpCompareRow (AVX2/SSE2). The packed planes are
+*   transposed 8x8 bits at a time into the stripe codes of 8 pixels.
+* - Phase shift (optional): the wrapped phase atan2(sum I_n sin, sum I_n cos) gives a
+*   sub-pixel position within the sine period; the Gray-code stripe picks the period.
+*
+* Pixels whose pattern and inverse differ by less than the minimum contrast in any bit
+* (shadows, surfaces outside the projection) are marked invalid. The rows are decoded in
+* bands across the shared AlpThreadPool.
+*
+* AlpSynthesizeCaptures renders what a camera would see of a pattern stack, so the decoder
+* can be checked and timed without a camera (see benchmarkDecoding).
+*
+* Usage:
+*
+*	long const bits = AlpFrames::grayCodeBits(1024);
+*	tAlpPatternSet const set{ 0, bits, 1024, 2 * bits, 4, 32 };	// Gray codes, then 4 phase shifts
+*	std::vector<float> columns;
+*	tAlpDecodeStats stats;
+*	if (AlpDecodePatterns(captures, set, columns, stats) == 0) ...
+*/
+
+#include "AlpFrames.h"
+#include <vector>
+
+/**
+* @brief The patterns of one axis within a capture stack, as drawn by drawGrayCode and drawPhaseShift.
+*/
+struct tAlpPatternSet {
+	long GrayFrame;				/* capture of the first Gray-code pattern; every pattern is followed by its inverse */
+	long Bits;					/* Gray-code patterns, 1 to 24 */
+	long Size;					/* projector columns (or rows) coded, the width (or height) the patterns were drawn with */
+	long PhaseFrame;			/* capture of the first phase-shift pattern, or -1 to decode the Gray code only */
+	long Steps;					/* phase-shift patterns, at least 3 */
+	long Period;				/* projector pixels per sine period */
+};
+
+/**
+* @brief Result of one AlpDecodePatterns call.
+*/
+struct tAlpDecodeStats {
+	unsigned long long Pixels;	/* camera pixels decoded */
+	unsigned long long Valid;	/* pixels with enough contrast */
+	double Seconds;				/* wall time of the decode */
+	double MegapixelsPerSecond;	/* Pixels / Seconds / 1e6 */
+};
+
+/**
+* @brief A flat scene seen by a synthetic camera, optionally with a dome in front of it.
+*
+* Camera pixel (u, v) sees projector position (OffsetX + Scale u + d, OffsetY + Scale v), where
+* d = Bump (1 - r^2) inside the ellipse inscribed in the camera image (r = 0 at its centre), the
+* disparity an object closer to the camera would cause.
+*/
+struct tAlpSyntheticScene {
+	double Scale;				/* projector pixels per camera pixel */
+	double OffsetX, OffsetY;	/* projector position seen by camera pixel (0, 0) */
+	double Bump;				/* [projector pixels] disparity at the centre of the dome, 0 for a plane */
+	double Ambient;				/* gray level of an unlit surface */
+	double Contrast;			/* gray levels added by a fully lit projector pixel */
+	double Noise;				/* amplitude of uniform sensor noise [gray levels] */
+};
+
+int AlpDecodePatterns(AlpFrames& captures, tAlpPatternSet const& set, std::vector<float>& positions,
+	tAlpDecodeStats& stats, const long minContrast = 16);
+
+void AlpSceneToProjector(tAlpSyntheticScene const& scene, const long cameraWidth, const long cameraHeight,
+	const double u, const double v, double& x, double& y);
+int AlpSynthesizeCaptures(AlpFrames& patterns, AlpFrames& captures, tAlpSyntheticScene const& scene);
@@ -0,0 +1,207 @@
+/**
+* @file AlpProfiler.cpp
+*
+* @brief ALP call instrumentation, see AlpProfiler.h.
+*
+* Functions are found through the address of the command text (a string literal per call
+* site), so the name is parsed only on the first call of each site. One mutex guards all
+* state; it is held for a few hundred nanoseconds per call, far below the latency of a USB
+* round trip.
+*/
+
+#include "AlpProfiler.h"
+#include "alp.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// 2^subBits buckets per power of two
+const int subBits = 5;
+const size_t bucketCount = (size_t)(64 - subBits + 1) << subBits;
+
+size_t BucketOf(const unsigned long long ns) {
+	if (ns < (1ULL << subBits))
+		return (size_t)ns;
+	int const exponent = std::bit_width(ns) - 1;
+	return ((size_t)(exponent - subBits + 1) << subBits) + (size_t)((ns >> (exponent - subBits)) & ((1ULL << subBits) - 1));
+}
+
+// Largest value counted in `bucket`
+unsigned long long BucketMax(const size_t bucket) {
+	if (bucket < (1ULL << subBits))
+		return bucket;
+	int const shift = (int)(bucket >> subBits) - 1;
+	unsigned long long const mantissa = (1ULL << subBits) + (bucket & ((1ULL << subBits) - 1));
+	return (mantissa << shift) + (1ULL << shift) - 1;
+}
+
+struct Function {
+	unsigned long long calls = 0, errors = 0, bytes = 0, total = 0, max = 0;
+	std::vector<unsigned long long> histogram = std::vector<unsigned long long>(bucketCount);
+};
+
+struct TraceEvent {
+	const char* name;
+	bool call;
+	int thread;
+	long long start, end;
+};
+
+std::mutex gMutex;
+std::map<std::string, Function> gFunctions;
+std::unordered_map<const void*, std::pair<const std::string*, Function*>> gSites;
+thread_local unsigned long long gPendingBytes = 0;
+
+bool gTracing = false;
+size_t gMaxEvents = 0;
+long long gTraceStart = 0;
+std::vector<TraceEvent> gEvents;
+std::map<std::thread::id, int> gThreads;
+
+// Caller holds gMutex
+void AddEvent(const char* name, const bool call, const long long start, const long long end) {
+	if (!gTracing || gEvents.size() >= gMaxEvents)
+		return;
+	auto const thread = gThreads.emplace(std::this_thread::get_id(), (int)gThreads.size() + 1).first->second;
+	gEvents.push_back(TraceEvent{ name, call, thread, start, end });
+}
+
+double Percentile(Function const& function, const double fraction) {
+	unsigned long long const rank = std::max(1ULL, (unsigned long long)(fraction * function.calls + 0.5));
+	unsigned long long seen = 0;
+	for (size_t bucket = 0; bucket < bucketCount; bucket++)
+		if ((seen += function.histogram[bucket]) >= rank)
+			return std::min(BucketMax(bucket), function.max) / 1000.;
+	return function.max / 1000.;
+}
+
+}
+
+long long AlpProfilerNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AlpProfilerRecord(LPCTSTR command, const long long start, const long long end, const long result) {
+	unsigned long long const bytes = gPendingBytes;
+	gPendingBytes = 0;
+
+	std::lock_guard<std::mutex> lock(gMutex);
+	auto site = gSites.find(command);
+	if (site == gSites.end()) {
+		std::string name;
+		for (LPCTSTR c = command; *c != 0 && *c != '(' && *c != ' '; c++)
+			name += (char)*c;
+		auto const entry = gFunctions.emplace(name, Function()).first;
+		site = gSites.emplace(command, std::make_pair(&entry->first, &entry->second)).first;
+	}
+	Function& function = *site->second.second;
+	unsigned long long const ns = (unsigned long long)std::max(end - start, 0LL);
+	function.calls++;
+	function.errors += result != ALP_OK;
+	function.bytes += bytes;
+	function.total += ns;
+	function.max = std::max(function.max, ns);
+	function.histogram[BucketOf(ns)]++;
+	AddEvent(site->second.first->c_str(), true, start, end);
+}
+
+void AlpProfilerBytes(const unsigned long long bytes) {
+	gPendingBytes = bytes;
+}
+
+/**
+* @brief Statistics of every function called so far, in alphabetical order.
+*/
+std::vector<tAlpCallStats> AlpProfilerSnapshot() {
+	std::lock_guard<std::mutex> lock(gMutex);
+	std::vector<tAlpCallStats> snapshot;
+	for (auto const& entry : gFunctions) {
+		Function const& function = entry.second;
+		if (function.calls == 0)
+			continue;
+		snapshot.push_back(tAlpCallStats{ entry.first, function.calls, function.errors, function.bytes,
+			function.total / 1000., Percentile(function, 0.5), Percentile(function, 0.99), function.max / 1000. });
+	}
+	return snapshot;
+}
+
+/**
+* @brief Prints a table of AlpProfilerSnapshot, slowest functions (by total time) first.
+*/
+void AlpProfilerDump(std::FILE* file) {
+	std::vector<tAlpCallStats> snapshot = AlpProfilerSnapshot();
+	std::sort(snapshot.begin(), snapshot.end(), [](tAlpCallStats const& a, tAlpCallStats const& b) { return a.Total > b.Total; });
+	std::fprintf(file, "%-28s %8s %6s %10s %10s %10s %10s %10s\n", "ALP call", "calls", "errors", "MB", "total [ms]", "p50 [us]", "p99 [us]", "max [us]");
+	for (auto const& stats : snapshot)
+		std::fprintf(file, "%-28s %8llu %6llu %10.2f %10.2f %10.1f %10.1f %10.1f\n", stats.Function.c_str(), stats.Calls, stats.Errors,
+			stats.Bytes / 1e6, stats.Total / 1000., stats.P50, stats.P99, stats.Max);
+}
+
+// Clears all statistics; a trace being recorded continues
+void AlpProfilerReset() {
+	std::lock_guard<std::mutex> lock(gMutex);
+	for (auto& entry : gFunctions)
+		entry.second = Function();
+}
+
+/**
+* @brief Starts recording a trace, discarding a previous one.
+*
+* @param maxEvents Events kept; later ones are dropped, so memory stays bounded (about 32 bytes each).
+*/
+void AlpTraceStart(const size_t maxEvents) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	gEvents.clear();
+	gEvents.reserve(std::min<size_t>(maxEvents, 1 << 16));
+	gMaxEvents = maxEvents;
+	gTraceStart = AlpProfilerNow();
+	gTracing = true;
+}
+
+/**
+* @brief Stops recording and writes the trace in the Chrome trace event format (JSON).
+*
+* ALP calls have the category "alp", spans the category "span"; every thread is a row.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int AlpTraceWrite(const char* path) {
+	std::lock_guard<std::mutex> lock(gMutex);
+	gTracing = false;
+	std::FILE* const file = std::fopen(path, "w");
+	if (file == nullptr) {
+		std::fprintf(stderr, "Error: Cannot write %s.\n", path);
+		return 1;
+	}
+	std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for (size_t i = 0; i < gEvents.size(); i++) {
+		TraceEvent const& event = gEvents[i];
+		std::fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			i == 0 ? "" : ",", event.name, event.call ? "alp" : "span", event.thread,
+			(event.start - gTraceStart) / 1000., (event.end - event.start) / 1000.);
+	}
+	std::fprintf(file, "\n]}\n");
+	bool const failed = std::ferror(file) != 0;
+	std::fclose(file);
+	if (failed) {
+		std::fprintf(stderr, "Error: Cannot write %s.\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+AlpTraceSpan::AlpTraceSpan(const char* name)
+	: _name(name), _start(AlpProfilerNow()) {
+}
+
+AlpTraceSpan::~AlpTraceSpan() {
+	long long const end = AlpProfilerNow();
+	std::lock_guard<std::mutex> lock(gMutex);
+	AddEvent(_name, false, _start, end);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+/**
+* @file AlpProfiler.h
+*
+* @brief Call counts, transferred bytes and latency histograms of ALP API calls, and an optional Chrome trace.
+*
+* VERIFY_ALP and VERIFY_ALP_NO_ECHO (Projector.h) run every call they wrap through
+* AlpProfileCall, which times it with the steady clock and records it under the name of the
+* called function. AlpUploader does the same for its AlpSeqPut calls. Latencies go into
+* log-linear (HDR-style) histograms with 32 buckets per power of two, so percentiles are
+* accurate to about 3% from nanoseconds to hours, in constant memory per function.
+*
+* AlpSeqPut does not tell how many bytes it transfers, so callers announce them with
+* AlpProfilerBytes right before the call.
+*
+* While a trace is recorded (AlpTraceStart), every call and every AlpTraceSpan (e.g. "render"
+* per frame, "project" per display) also becomes an event of a Chrome trace, which
+* AlpTraceWrite saves for chrome://tracing or https://ui.perfetto.dev.
+*
+* All functions are thread-safe.
+*/
+
+#include "stdafx.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+* @brief Accumulated statistics of one function.
+*/
+struct tAlpCallStats {
+	std::string Function;		/* name of the called function, e.g. "AlpSeqPut" */
+	unsigned long long Calls;	/* calls recorded */
+	unsigned long long Errors;	/* calls not returning ALP_OK */
+	unsigned long long Bytes;	/* announced with AlpProfilerBytes */
+	double Total;				/* [us] sum of all latencies */
+	double P50, P99, Max;		/* [us] latency percentiles and maximum */
+};
+
+// Steady clock [ns]
+long long AlpProfilerNow();
+
+// Records a call of `command` (its source text, the function name is taken up to the '(')
+void AlpProfilerRecord(LPCTSTR command, const long long start, const long long end, const long result);
+
+// Bytes transferred by the next call recorded on this thread
+void AlpProfilerBytes(const unsigned long long bytes);
+
+// Runs `call` (returning an ALP error code), records it, and returns its result
+template <class Call>
+long AlpProfileCall(LPCTSTR command, Call const& call) {
+	long long const start = AlpProfilerNow();
+	long const result = call();
+	AlpProfilerRecord(command, start, AlpProfilerNow(), result);
+	return result;
+}
+
+std::vector<tAlpCallStats> AlpProfilerSnapshot();
+void AlpProfilerDump(std::FILE* file = stdout);
+void AlpProfilerReset();
+
+void AlpTraceStart(const size_t maxEvents = 1 << 20);
+int AlpTraceWrite(const char* path);
+
+/**
+* @brief Records the lifetime of the object as a span of the trace, e.g. one rendered frame.
+*
+* @param name A string literal; it is referenced, not copied.
+*/
+class AlpTraceSpan {
+public:
+	explicit AlpTraceSpan(const char* name);
+	~AlpTraceSpan();
+
+private:
+	const char* const _name;
+	const long long _start;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+/**
+* @file AlpSequenceFile.h
+*
+* @brief Layout of pre-packed sequence files (.alpseq), which hold frames exactly as AlpSeqPut takes them.
+*
+* A file starts with tAlpSeqFileHeader, followed by the frame index (FrameCount 64-bit file
+* offsets, at IndexOffset) and the frame payloads. Every payload starts at a multiple of
+* ALP_SEQ_FILE_ALIGN bytes, so frames whose size is a multiple of it lie back to back and
+* the whole sequence is loaded with a single AlpSeqPut. Binary frames are packed as
+* ALP_DATA_BINARY_TOPDOWN (RowBytes per row, see AlpFrames::binaryRowBytes), gray frames
+* hold one byte per mirror. All numbers are little-endian.
+*
+* Written by AlpFrames::writeSequenceFile, mapped by AlpImageFiles::openSequence.
+*/
+
+#include <cstdint>
+
+#define ALP_SEQ_FILE_MAGIC "ALPSEQ1"	/* 8 bytes including the terminating zero */
+#define ALP_SEQ_FILE_ALIGN 64			/* [bytes] alignment of the frame payloads */
+
+struct tAlpSeqFileHeader {
+	char Magic[8];				/* ALP_SEQ_FILE_MAGIC */
+	uint32_t HeaderBytes;		/* sizeof(tAlpSeqFileHeader), differs between versions */
+	uint32_t Format;			/* 0: gray8, 1: binary, as AlpFrames::PixelFormat */
+	int32_t Width, Height;		/* [pixels] frame dimensions; Height is the rows of an area of interest */
+	int32_t FirstRow;			/* DMD row shown by the first row of the frames (ALP_SEQ_DMD_LINES) */
+	int32_t BitPlanes;			/* ALP_BITPLANES of the sequence: 1 for binary frames, 2 to 8 for gray frames */
+	int32_t RowBytes;			/* [bytes] row pitch of the frames */
+	uint32_t FrameCount;		/* frames in the sequence */
+	uint64_t FrameBytes;		/* [bytes] RowBytes * Height */
+	uint32_t Timing[5];			/* [us] as Projector::getTimingParams: illuminate, picture, synch delay, synch pulse width, trigger-in delay */
+	uint32_t Reserved;			/* 0 */
+	uint64_t IndexOffset;		/* [bytes] file offset of the frame index */
+};
+
+static_assert(sizeof(tAlpSeqFileHeader) == 80, "tAlpSeqFileHeader must not contain padding");
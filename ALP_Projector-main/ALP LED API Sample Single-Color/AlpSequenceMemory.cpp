@@ -0,0 +1,146 @@
+/**
+* @file AlpSequenceMemory.cpp
+*
+* @brief Sequence memory bookkeeping with LRU eviction, see AlpSequenceMemory.h.
+*/
+
+#include "AlpSequenceMemory.h"
+#include "AlpProfiler.h"
+
+AlpSequenceMemory::AlpSequenceMemory()
+	: _deviceId(ALP_INVALID_ID), _capacity(0), _used(0), _width(0), _height(0),
+	_clock(0), _allocations(0), _evictions(0) {
+}
+
+/**
+* @brief Takes over the memory of an allocated device.
+*
+* The capacity is the memory available now; sequences allocated before are not managed.
+*
+* @return long, ALP_OK or the error code of AlpDevInquire.
+*/
+long AlpSequenceMemory::attach(const ALP_ID deviceId) {
+	long result;
+	_deviceId = deviceId;
+	_sequences.clear();
+	_used = 0;
+	if ((result = AlpProfileCall(_T("AlpDevInquire"), [&] { return AlpDevInquire(deviceId, ALP_AVAIL_MEMORY, &_capacity); })) != ALP_OK)
+		return result;
+	if ((result = AlpProfileCall(_T("AlpDevInquire"), [&] { return AlpDevInquire(deviceId, ALP_DEV_DISPLAY_WIDTH, &_width); })) != ALP_OK)
+		return result;
+	return AlpProfileCall(_T("AlpDevInquire"), [&] { return AlpDevInquire(deviceId, ALP_DEV_DISPLAY_HEIGHT, &_height); });
+}
+
+/**
+* @brief Allocates a sequence like AlpSeqAlloc, evicting least recently projected sequences if it does not fit.
+*
+* The device's ALP_AVAIL_MEMORY decides whether the sequence fits, so memory allocated
+* outside of this class is respected as well. If AlpSeqAlloc still reports ALP_MEMORY_FULL
+* (e.g. fragmentation), further sequences are evicted and the allocation is retried.
+*
+* @return long, ALP_OK, ALP_MEMORY_FULL if the sequence does not fit even after evicting
+* every unpinned sequence, or another error code of AlpSeqAlloc.
+*/
+long AlpSequenceMemory::alloc(const long bitPlanes, const long picNum, ALP_ID* sequenceId) {
+	long const pictures = bitPlanes * picNum;
+	for (;;) {
+		long available = 0;
+		long result = AlpProfileCall(_T("AlpDevInquire"), [&] { return AlpDevInquire(_deviceId, ALP_AVAIL_MEMORY, &available); });
+		if (result != ALP_OK)
+			return result;
+		if (available >= pictures) {
+			result = AlpProfileCall(_T("AlpSeqAlloc"), [&] { return AlpSeqAlloc(_deviceId, bitPlanes, picNum, sequenceId); });
+			if (result == ALP_OK) {
+				_sequences[*sequenceId] = Sequence{ pictures, ++_clock, false };
+				_used += pictures;
+				_allocations++;
+				return ALP_OK;
+			}
+			if (result != ALP_MEMORY_FULL)
+				return result;
+		}
+		if (evictOne() != ALP_OK)
+			return ALP_MEMORY_FULL;
+	}
+}
+
+/**
+* @brief Frees a sequence like AlpSeqFree and stops accounting it.
+*/
+long AlpSequenceMemory::free(const ALP_ID sequenceId) {
+	long const result = AlpProfileCall(_T("AlpSeqFree"), [&] { return AlpSeqFree(_deviceId, sequenceId); });
+	if (result != ALP_OK)
+		return result;
+	auto const it = _sequences.find(sequenceId);
+	if (it != _sequences.end()) {
+		_used -= it->second.pictures;
+		_sequences.erase(it);
+	}
+	return ALP_OK;
+}
+
+/**
+* @brief Marks a sequence as just projected, moving it to the end of the eviction order.
+*/
+void AlpSequenceMemory::touch(const ALP_ID sequenceId) {
+	auto const it = _sequences.find(sequenceId);
+	if (it != _sequences.end())
+		it->second.lastUsed = ++_clock;
+}
+
+void AlpSequenceMemory::pin(const ALP_ID sequenceId, const bool pinned) {
+	auto const it = _sequences.find(sequenceId);
+	if (it != _sequences.end())
+		it->second.pinned = pinned;
+}
+
+void AlpSequenceMemory::setEvictionHandler(std::function<void(ALP_ID)> const& handler) {
+	_onEvict = handler;
+}
+
+/**
+* @brief Reports the occupancy, including the device's ALP_AVAIL_MEMORY.
+*
+* @return long, ALP_OK or the error code of AlpDevInquire.
+*/
+long AlpSequenceMemory::getStats(tAlpSeqMemoryStats& stats) const {
+	stats.Capacity = _capacity;
+	stats.Used = _used;
+	stats.UsedBytes = (unsigned long long)_used * (_width / 8) * _height;
+	stats.Sequences = (unsigned long)_sequences.size();
+	stats.Pinned = 0;
+	for (auto const& entry : _sequences)
+		stats.Pinned += entry.second.pinned ? 1 : 0;
+	stats.Allocations = _allocations;
+	stats.Evictions = _evictions;
+	return AlpProfileCall(_T("AlpDevInquire"), [&] { return AlpDevInquire(_deviceId, ALP_AVAIL_MEMORY, &stats.Available); });
+}
+
+/**
+* @brief Frees the least recently projected sequence that is neither pinned nor in use.
+*
+* @return long, ALP_OK, or ALP_MEMORY_FULL if no sequence could be freed.
+*/
+long AlpSequenceMemory::evictOne() {
+	// sequences the device refuses to free (ALP_SEQ_IN_USE) are skipped in this pass
+	std::set<ALP_ID> refused;
+	for (;;) {
+		auto victim = _sequences.end();
+		for (auto it = _sequences.begin(); it != _sequences.end(); ++it)
+			if (!it->second.pinned && refused.count(it->first) == 0
+				&& (victim == _sequences.end() || it->second.lastUsed < victim->second.lastUsed))
+				victim = it;
+		if (victim == _sequences.end())
+			return ALP_MEMORY_FULL;
+
+		ALP_ID const sequenceId = victim->first;
+		if (free(sequenceId) != ALP_OK) {
+			refused.insert(sequenceId);
+			continue;
+		}
+		_evictions++;
+		if (_onEvict)
+			_onEvict(sequenceId);
+		return ALP_OK;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+/**
+* @file AlpSequenceMemory.h
+*
+* @brief Bookkeeping of the ALP on-board sequence memory, with LRU eviction.
+*
+* All sequences of a device are allocated through AlpSequenceMemory::alloc, which
+* accounts their size (bit planes x pictures, in binary pictures of the full DMD as
+* ALP_AVAIL_MEMORY reports it). If a new sequence does not fit, the sequences projected
+* least recently are freed with AlpSeqFree until it does. Pinned sequences (e.g. the
+* slots of a stream) and sequences the device reports as in use are never evicted.
+*
+* The functions return ALP error codes, so they can be checked with VERIFY_ALP_NO_ECHO.
+*/
+
+#include "stdafx.h"
+#include "alp.h"
+#include <functional>
+#include <map>
+#include <set>
+
+/**
+* @brief Occupancy of the sequence memory.
+*/
+struct tAlpSeqMemoryStats {
+	long Capacity;					/* [binary pictures] on-board sequence memory */
+	long Used;						/* [binary pictures] allocated through AlpSequenceMemory */
+	long Available;					/* [binary pictures] ALP_AVAIL_MEMORY */
+	unsigned long long UsedBytes;	/* Used, expressed as bytes of binary DMD data */
+	unsigned long Sequences;		/* resident sequences */
+	unsigned long Pinned;			/* sequences excluded from eviction */
+	unsigned long Allocations;		/* successful alloc calls */
+	unsigned long Evictions;		/* sequences freed to make room */
+};
+
+class AlpSequenceMemory {
+public:
+	AlpSequenceMemory();
+
+	long attach(const ALP_ID deviceId);
+
+	long alloc(const long bitPlanes, const long picNum, ALP_ID* sequenceId);
+	long free(const ALP_ID sequenceId);
+
+	void touch(const ALP_ID sequenceId);
+	void pin(const ALP_ID sequenceId, const bool pinned);
+
+	// Called with every sequence freed by eviction, e.g. to drop it from a cache
+	void setEvictionHandler(std::function<void(ALP_ID)> const& handler);
+
+	long getStats(tAlpSeqMemoryStats& stats) const;
+
+private:
+	struct Sequence {
+		long pictures;
+		unsigned long long lastUsed;
+		bool pinned;
+	};
+
+	long evictOne();
+
+	ALP_ID _deviceId;
+	long _capacity, _used, _width, _height;
+	unsigned long long _clock;
+	unsigned long _allocations, _evictions;
+	std::map<ALP_ID, Sequence> _sequences;
+	std::function<void(ALP_ID)> _onEvict;
+};
@@ -0,0 +1,87 @@
+/**
+* @file AlpSimulatedCamera.cpp
+*
+* @brief Simulated camera trigger, see AlpSimulatedCamera.h.
+*/
+
+#include "AlpSimulatedCamera.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+AlpSimulatedCamera::AlpSimulatedCamera()
+	: _frameRate(0), _exposureTime(0), _frames(0), _exposures(0), _maxJitter(0), _stop(false) {
+}
+
+AlpSimulatedCamera::~AlpSimulatedCamera() {
+	stop();
+}
+
+/**
+* @brief Starts exposing on a background thread.
+*
+* @param frameRate Exposures per second.
+* @param exposureTime Duration of each exposure [us], shorter than the frame period.
+* @param trigger Called at the end of every exposure, on the camera thread.
+* @param frames Exposures to take, 0 until stop().
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int AlpSimulatedCamera::start(const double frameRate, const unsigned long exposureTime, std::function<void()> const& trigger, const unsigned long long frames) {
+	if (_thread.joinable()) {
+		std::cerr << "Error: The camera has already been started." << std::endl;
+		return 1;
+	}
+	if (frameRate <= 0 || exposureTime >= 1e6 / frameRate) {
+		std::cerr << "Error: The exposure time must be shorter than the frame period." << std::endl;
+		return 1;
+	}
+	_frameRate = frameRate, _exposureTime = exposureTime, _frames = frames, _trigger = trigger;
+	_exposures = 0, _maxJitter = 0, _stop = false;
+	_thread = std::thread(&AlpSimulatedCamera::expose, this);
+	return 0;
+}
+
+// Blocks until all `frames` exposures have been taken
+void AlpSimulatedCamera::wait() {
+	if (_thread.joinable())
+		_thread.join();
+}
+
+// Ends exposing, the current exposure does not trigger any more
+void AlpSimulatedCamera::stop() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_stopRequested.notify_all();
+	if (_thread.joinable())
+		_thread.join();
+}
+
+unsigned long long AlpSimulatedCamera::exposureCount() const {
+	return _exposures;
+}
+
+// Largest delay of a trigger behind its scheduled time [us]
+double AlpSimulatedCamera::maxJitter() const {
+	return _maxJitter / 1000.;
+}
+
+void AlpSimulatedCamera::expose() {
+	auto const start = std::chrono::steady_clock::now();
+	auto const period = std::chrono::duration<double>(1. / _frameRate);
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (unsigned long long k = 0; _frames == 0 || k < _frames; k++) {
+		auto const exposureEnd = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(k * period)
+			+ std::chrono::microseconds(_exposureTime);
+		if (_stopRequested.wait_until(lock, exposureEnd, [this] { return _stop; }))
+			return;
+		lock.unlock();
+		long long const jitter = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - exposureEnd).count();
+		_trigger();
+		_exposures++;
+		_maxJitter = std::max(_maxJitter.load(), jitter);
+		lock.lock();
+	}
+}
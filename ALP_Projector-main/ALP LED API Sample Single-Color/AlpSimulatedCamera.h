@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+* @file AlpSimulatedCamera.h
+*
+* @brief A free-running camera model that fires a trigger at the end of every exposure, for testing triggered projection.
+*
+* In a camera-synchronized acquisition, the exposure output of the camera is wired to the
+* trigger input of the ALP, so the projector advances to the next pattern as soon as the
+* camera has captured the current one (Projector::projectTriggered). This class stands in
+* for the camera: a thread exposes `frames` frames at `frameRate` frames per second and calls
+* `trigger` at the end of each exposure, e.g. AlpEmuTrigger of the emulator.
+*
+* Exposures are scheduled on the steady clock, so late wake-ups do not accumulate into a
+* lower frame rate; the largest delay of a trigger behind its schedule is reported as jitter.
+*
+* Usage:
+*
+*	AlpSimulatedCamera camera;
+*	camera.start(500., 1500, [&] { AlpEmuTrigger(deviceId); }, 24);
+*	... projection ...
+*	camera.wait();
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class AlpSimulatedCamera {
+public:
+	AlpSimulatedCamera();
+	~AlpSimulatedCamera();
+
+	AlpSimulatedCamera(const AlpSimulatedCamera&) = delete;
+	AlpSimulatedCamera& operator=(const AlpSimulatedCamera&) = delete;
+
+	int start(const double frameRate, const unsigned long exposureTime, std::function<void()> const& trigger, const unsigned long long frames = 0);
+	void wait();
+	void stop();
+
+	unsigned long long exposureCount() const;
+	double maxJitter() const;
+
+private:
+	void expose();
+
+	double _frameRate;
+	unsigned long _exposureTime;
+	unsigned long long _frames;
+	std::function<void()> _trigger;
+
+	std::atomic<unsigned long long> _exposures;
+	std::atomic<long long> _maxJitter;
+	bool _stop;
+	std::mutex _mutex;
+	std::condition_variable _stopRequested;
+	std::thread _thread;
+};
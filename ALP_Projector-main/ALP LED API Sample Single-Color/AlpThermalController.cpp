@@ -0,0 +1,91 @@
+/**
+* @file AlpThermalController.cpp
+*
+* @brief Thermal brightness control, see AlpThermalController.h.
+*/
+
+#include "AlpThermalController.h"
+#include <algorithm>
+#include <cmath>
+
+AlpThermalController::AlpThermalController()
+	: _ceiling(0), _kp(0), _ki(0), _integral(0), _derated(0), _controlled(0), _maxBrightness(0), _minOutput(0) {
+}
+
+/**
+* @brief Sets the temperature ceiling and the controller gains.
+*
+* @param ceiling Junction temperature to stay below [degC]; 0 or less disables the controller.
+* @param kp Proportional gain [% brightness per degC].
+* @param ki Integral gain [% brightness per degC and second].
+*
+* A starting point is kp = tau / (K * lambda) and ki = kp / tau, with the thermal time constant
+* tau of the LED [s], its temperature rise K per % brightness [degC/%], and the desired settling
+* time lambda [s]. Since the brightness is only reduced once the ceiling has been reached, the
+* junction overshoots it briefly; higher gains shorten the overshoot.
+*/
+void AlpThermalController::configure(const double ceiling, const double kp, const double ki) {
+	_ceiling = ceiling; _kp = kp; _ki = ki;
+}
+
+bool AlpThermalController::enabled() const {
+	return _ceiling > 0;
+}
+
+/**
+* @brief Starts controlling at full output and clears the statistics.
+*
+* @param maxBrightness The requested brightness [%], never exceeded.
+*/
+void AlpThermalController::reset(const long maxBrightness) {
+	_maxBrightness = maxBrightness;
+	_integral = maxBrightness;
+	_minOutput = maxBrightness;
+	_derated = 0, _controlled = 0;
+}
+
+/**
+* @brief Changes the requested brightness while under control, keeping the statistics.
+*
+* The output follows a lower maximum at the next update, and rises towards a higher one as
+* far as the ceiling allows.
+*/
+void AlpThermalController::setMaxBrightness(const long maxBrightness) {
+	_maxBrightness = maxBrightness;
+	_integral = std::min(_integral, (double)maxBrightness);
+}
+
+/**
+* @brief Computes the brightness for the next control period.
+*
+* @param junctionTemp The measured junction temperature [degC].
+* @param dt Time since the previous update [s].
+*
+* @return long, the brightness [%], 0 to the maximum brightness.
+*/
+long AlpThermalController::update(const double junctionTemp, const double dt) {
+	double const error = _ceiling - junctionTemp;
+	_integral = std::clamp(_integral + _ki * error * dt, 0., (double)_maxBrightness);
+	long const output = std::clamp((long)std::lround(_integral + _kp * error), 0L, _maxBrightness);
+
+	_controlled += dt;
+	if (output < _maxBrightness)
+		_derated += dt;
+	_minOutput = std::min(_minOutput, output);
+	return output;
+}
+
+// Time with a brightness below the maximum [s]
+double AlpThermalController::deratedTime() const {
+	return _derated;
+}
+
+// Time under control since reset [s]
+double AlpThermalController::controlledTime() const {
+	return _controlled;
+}
+
+// Lowest brightness since reset [%]
+long AlpThermalController::minBrightness() const {
+	return _minOutput;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+/**
+* @file AlpThermalController.h
+*
+* @brief PI controller holding the LED junction temperature below a ceiling by adjusting the brightness.
+*
+* While the junction is cooler than the ceiling, the output stays at the requested (maximum)
+* brightness. When the junction approaches the ceiling, the brightness is reduced just enough
+* to hold it there, and raised again as soon as the LED cools down, e.g. when the ambient
+* temperature drops. Long exposures thus run at the highest sustainable brightness instead of
+* being aborted by the hard limit of Projector::checkLEDExceedsLimits.
+*
+* The integral term is clamped to the output range (anti-windup), so the brightness recovers
+* without delay once derating is no longer needed. Time spent below the maximum brightness is
+* accumulated as "derated".
+*
+* Usage:
+*
+*	controller.configure(ceiling, kp, ki);
+*	controller.reset(brightness);
+*	for (...) {
+*		long const output = controller.update(junctionTemp, dt);
+*		... AlpLedControl(ALP_LED_BRIGHTNESS, output) if it changed ...
+*	}
+*/
+
+class AlpThermalController {
+public:
+	AlpThermalController();
+
+	void configure(const double ceiling, const double kp, const double ki);
+	bool enabled() const;
+
+	void reset(const long maxBrightness);
+	void setMaxBrightness(const long maxBrightness);
+	long update(const double junctionTemp, const double dt);
+
+	double deratedTime() const;
+	double controlledTime() const;
+	long minBrightness() const;
+
+private:
+	double _ceiling, _kp, _ki, _integral, _derated, _controlled;
+	long _maxBrightness, _minOutput;
+};
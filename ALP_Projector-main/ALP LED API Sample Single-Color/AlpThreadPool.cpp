@@ -0,0 +1,118 @@
+/**
+* @file AlpThreadPool.cpp
+*
+* @brief Work-stealing thread pool, see AlpThreadPool.h.
+*/
+
+#include "AlpThreadPool.h"
+#include <algorithm>
+
+/**
+* @brief Starts the worker threads.
+*
+* @param threads The number of workers, 0 for one per CPU core besides the calling thread.
+*/
+AlpThreadPool::AlpThreadPool(unsigned threads) : _pending(0), _stop(false) {
+	if (threads == 0)
+		threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	for (unsigned i = 0; i < threads; i++)
+		_queues.push_back(std::make_unique<Queue>());
+	for (unsigned i = 0; i < threads; i++)
+		_workers.emplace_back(&AlpThreadPool::work, this, (size_t)i);
+}
+
+AlpThreadPool::~AlpThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for (auto& worker : _workers)
+		worker.join();
+}
+
+AlpThreadPool& AlpThreadPool::shared() {
+	static AlpThreadPool pool;
+	return pool;
+}
+
+unsigned AlpThreadPool::concurrency() const {
+	return (unsigned)_workers.size() + 1;
+}
+
+/**
+* @brief Runs `body` over [begin, end) on all threads of the pool and returns when it is done.
+*
+* @param begin, end The index range, e.g. frame or row numbers.
+* @param body Called concurrently with disjoint sub-ranges.
+* @param grain The largest sub-range handed to one call of `body`.
+*/
+void AlpThreadPool::parallelFor(const long begin, const long end, std::function<void(long, long)> const& body, const long grain) {
+	if (end <= begin)
+		return;
+	long const step = std::max(grain, 1L);
+	if (_workers.empty() || end - begin <= step) {
+		body(begin, end);
+		return;
+	}
+
+	std::atomic<long> remaining((end - begin + step - 1) / step);
+	size_t queue = 0;
+	for (long first = begin; first < end; first += step, queue = (queue + 1) % _queues.size()) {
+		long const last = std::min(first + step, end);
+		std::lock_guard<std::mutex> lock(_queues[queue]->mutex);
+		_queues[queue]->tasks.emplace_back([&body, &remaining, first, last] {
+			body(first, last);
+			remaining.fetch_sub(1, std::memory_order_release);
+		});
+		_pending.fetch_add(1);
+	}
+	{
+		// taking the lock orders the new tasks before a worker re-checks its wait condition
+		std::lock_guard<std::mutex> lock(_mutex);
+	}
+	_wake.notify_all();
+
+	while (remaining.load(std::memory_order_acquire) > 0)
+		if (!runOne(0))
+			std::this_thread::yield();
+}
+
+/**
+* @brief Executes one task, preferably from the back of queue `home`, otherwise stolen from another queue.
+*
+* @return bool, false if all queues were empty.
+*/
+bool AlpThreadPool::runOne(const size_t home) {
+	std::function<void()> task;
+	for (size_t i = 0; i < _queues.size() && !task; i++) {
+		Queue& queue = *_queues[(home + i) % _queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+		if (i == 0) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+	}
+	if (!task)
+		return false;
+	_pending.fetch_sub(1);
+	task();
+	return true;
+}
+
+void AlpThreadPool::work(const size_t index) {
+	for (;;) {
+		if (runOne(index))
+			continue;
+		std::unique_lock<std::mutex> lock(_mutex);
+		_wake.wait(lock, [this] { return _pending.load() > 0 || _stop; });
+		if (_stop)
+			return;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+/**
+* @file AlpThreadPool.h
+*
+* @brief Work-stealing thread pool for data-parallel rendering.
+*
+* parallelFor splits an index range into chunks that are spread over per-worker queues.
+* Each worker takes chunks from the back of its own queue and, once that is empty,
+* steals from the front of the others, so uneven chunk costs balance out. The calling
+* thread executes chunks as well until the whole range is done, which also makes nested
+* parallelFor calls safe.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class AlpThreadPool {
+public:
+	explicit AlpThreadPool(unsigned threads = 0);
+	~AlpThreadPool();
+
+	// Pool with one worker per CPU core besides the calling thread
+	static AlpThreadPool& shared();
+
+	// Threads taking part in parallelFor, including the caller
+	unsigned concurrency() const;
+
+	// Calls body(first, last) for consecutive sub-ranges [first, last) of at most `grain` indices
+	void parallelFor(const long begin, const long end, std::function<void(long, long)> const& body, const long grain = 1);
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	bool runOne(const size_t home);
+	void work(const size_t index);
+
+	std::vector<std::unique_ptr<Queue>> _queues;
+	std::vector<std::thread> _workers;
+	std::atomic<long> _pending;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	bool _stop;
+};
@@ -0,0 +1,135 @@
+/**
+* @file AlpUploader.cpp
+*
+* @brief Producer/consumer upload of a sequence, see AlpUploader.h.
+*
+* Frame `n` lives in slot `n % slots`. Frames are handed out and uploaded in ascending
+* order; a slot is reused once its frame has been transferred. The ring is one contiguous
+* block, so consecutive ready slots up to the end of the ring form a single AlpSeqPut.
+*/
+
+#include "AlpUploader.h"
+#include "AlpProfiler.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+* @brief Starts the upload thread for an allocated sequence.
+*
+* @param deviceId, sequenceId The sequence to load; data format and bit planes must already be set.
+* @param frames The number of frames to load.
+* @param frameBytes The size of one frame as expected by AlpSeqPut (see AlpFrames::frameBytes).
+* @param pictureOffset The picture number of the first frame within the sequence.
+* @param slots The number of frames buffered on the host.
+* @param maxChunk The largest number of frames loaded by one AlpSeqPut. Smaller chunks
+* release slots earlier, larger ones save per-call overhead.
+*/
+AlpUploader::AlpUploader(const ALP_ID deviceId, const ALP_ID sequenceId, const long frames, const size_t frameBytes,
+	const long pictureOffset, const long slots, const long maxChunk)
+	: _deviceId(deviceId), _sequenceId(sequenceId), _frames(frames), _pictureOffset(pictureOffset),
+	_slots(std::max(slots, 1L)), _maxChunk(std::clamp(maxChunk, 1L, std::max(slots, 1L))), _frameBytes(frameBytes),
+	_ring(_slots * frameBytes), _ready(_slots, false), _nextAcquire(0), _nextUpload(0), _result(ALP_OK), _abort(false) {
+	_start = _firstLoaded = _lastLoaded = std::chrono::steady_clock::now();
+	_thread = std::thread(&AlpUploader::run, this);
+}
+
+AlpUploader::~AlpUploader() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_abort = true;
+	}
+	_slotReady.notify_all();
+	_slotFree.notify_all();
+	if (_thread.joinable())
+		_thread.join();
+}
+
+/**
+* @brief Hands out the slot of the next frame to render, cleared to zero.
+*
+* Blocks while all slots are waiting for the upload.
+*
+* @param[out] frame The slot to render into, `frameBytes` bytes.
+*
+* @return long, the frame number to render, or -1 if all frames have been handed out or the upload failed.
+*/
+long AlpUploader::acquire(char unsigned*& frame) {
+	long frameNum;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_slotFree.wait(lock, [this] { return _nextAcquire - _nextUpload < _slots || _result != ALP_OK || _abort; });
+		if (_nextAcquire >= _frames || _result != ALP_OK || _abort)
+			return -1;
+		frameNum = _nextAcquire++;
+	}
+	frame = &_ring[(frameNum % _slots) * _frameBytes];
+	memset(frame, 0, _frameBytes);
+	return frameNum;
+}
+
+/**
+* @brief Marks a frame handed out by acquire as rendered.
+*/
+void AlpUploader::commit(const long frameNum) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_ready[frameNum % _slots] = true;
+	}
+	_slotReady.notify_one();
+}
+
+/**
+* @brief Waits until every frame has been loaded, or the upload failed.
+*
+* Each frame handed out by acquire must be committed before, otherwise this never returns.
+*
+* @return long, ALP_OK or the error code of the failed AlpSeqPut.
+*/
+long AlpUploader::finish() {
+	if (_thread.joinable())
+		_thread.join();
+	return _result;
+}
+
+// Seconds from construction until the first AlpSeqPut completed
+double AlpUploader::timeToFirstFrame() const {
+	return std::chrono::duration<double>(_firstLoaded - _start).count();
+}
+
+// Seconds from construction until the last AlpSeqPut completed
+double AlpUploader::loadTime() const {
+	return std::chrono::duration<double>(_lastLoaded - _start).count();
+}
+
+void AlpUploader::run() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (_nextUpload < _frames) {
+		_slotReady.wait(lock, [this] { return _ready[_nextUpload % _slots] || _abort; });
+		if (_abort)
+			break;
+
+		// consecutive rendered frames, without wrapping around the end of the ring
+		long const first = _nextUpload % _slots;
+		long count = 1;
+		while (count < _maxChunk && _nextUpload + count < _frames && first + count < _slots && _ready[first + count])
+			count++;
+
+		lock.unlock();
+		AlpProfilerBytes(count * _frameBytes);
+		long const result = AlpProfileCall(_T("AlpSeqPut"), [&] { return AlpSeqPut(_deviceId, _sequenceId, _pictureOffset + _nextUpload, count, &_ring[first * _frameBytes]); });
+		lock.lock();
+
+		if (result != ALP_OK) {
+			_result = result;
+			break;
+		}
+		_lastLoaded = std::chrono::steady_clock::now();
+		if (_nextUpload == 0)
+			_firstLoaded = _lastLoaded;
+		std::fill(_ready.begin() + first, _ready.begin() + first + count, false);
+		_nextUpload += count;
+		_slotFree.notify_all();
+	}
+	lock.unlock();
+	_slotFree.notify_all();
+}
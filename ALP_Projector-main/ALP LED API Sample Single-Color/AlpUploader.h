@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+* @file AlpUploader.h
+*
+* @brief Overlaps rendering and USB transfer of a sequence.
+*
+* Frames are rendered into a bounded ring of frame slots. A dedicated upload thread
+* loads finished slots into the sequence with AlpSeqPut (PicOffset/PicLoad), combining
+* consecutive slots into one transfer. Producers block while the ring is full, so the
+* host memory used is independent of the sequence length, and the time until the whole
+* sequence is loaded becomes max(render, transfer) instead of their sum.
+*
+* Usage, from one or several render threads:
+*
+*	char unsigned* data;
+*	for (long frameNum; (frameNum = uploader.acquire(data)) >= 0; ) {
+*		... render frame `frameNum` into `data` ...
+*		uploader.commit(frameNum);
+*	}
+*
+* followed by uploader.finish(), which returns the ALP error code of the transfer.
+*/
+
+#include "stdafx.h"
+#include "alp.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class AlpUploader {
+public:
+	AlpUploader(const ALP_ID deviceId, const ALP_ID sequenceId, const long frames, const size_t frameBytes,
+		const long pictureOffset = 0, const long slots = 8, const long maxChunk = 4);
+	~AlpUploader();
+
+	long acquire(char unsigned*& frame);
+	void commit(const long frameNum);
+	long finish();
+
+	double timeToFirstFrame() const;
+	double loadTime() const;
+
+private:
+	void run();
+
+	const ALP_ID _deviceId, _sequenceId;
+	const long _frames, _pictureOffset, _slots, _maxChunk;
+	const size_t _frameBytes;
+
+	std::vector<char unsigned> _ring;
+	std::vector<bool> _ready;
+	long _nextAcquire, _nextUpload, _result;
+	bool _abort;
+
+	std::mutex _mutex;
+	std::condition_variable _slotFree, _slotReady;
+	std::chrono::steady_clock::time_point _start, _firstLoaded, _lastLoaded;
+	std::thread _thread;
+};
@@ -1,7 +1,9 @@
 
 #include "AlpUserInterface.h"
 #include "alp.h"
+#ifdef _WIN32
 #include <conio.h>
+#endif
 #include <stdexcept>
 
 void Pause() {
@@ -0,0 +1,301 @@
+/**
+* @file Benchmark.cpp
+*
+* @brief Micro-benchmarks of the host-side render and upload path, see Benchmark.h.
+*/
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "AlpFrames.h"
+#include "AlpPack.h"
+#include "AlpPatternDecoder.h"
+#include "AlpThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Repeats `body` until at least `minSeconds` have passed and returns the seconds per repetition
+template <typename Body>
+double timePerRun(Body body, const double minSeconds = 0.5) {
+	body();	// warm-up: page faults, caches
+	long runs = 0;
+	Clock::time_point const start = Clock::now();
+	double elapsed = 0.;
+	do {
+		body();
+		runs++;
+		elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+	} while (elapsed < minSeconds);
+	return elapsed / runs;
+}
+
+struct FramesCase {
+	const char* name;
+	AlpFrames::PixelFormat format;
+	long minFrames;
+	// draws all frames of `frames`; `gray` holds random gray frames of the same size
+	std::function<void(AlpFrames& frames, AlpFrames& gray)> run;
+};
+
+// Draws the single-frame pattern `draw` into every frame, as generatePattern does
+std::function<void(AlpFrames&, AlpFrames&)> everyFrame(std::function<void(AlpFrames&)> const& draw) {
+	return [draw](AlpFrames& frames, AlpFrames&) {
+		frames.renderFrames(0, frames._frameCount, [&](AlpFrames& frame, long) { draw(frame); });
+	};
+}
+
+}
+
+/**
+* @brief Measures how fast each available kernel thresholds and packs 1920x1080 gray frames.
+*
+* Reports the input throughput in GB/s on one core and the resulting frame rate. A
+* sequence of 16 frames (33 MB) is used so the data does not fit into the caches. The kernel
+* is called on this thread, as packFrom does per frame, since packFrom spreads the frames
+* over all cores.
+*/
+void benchmarkPacking() {
+	long const frames = 16, width = 1920, height = 1080;
+	AlpFrames gray(frames, width, height);
+	AlpFrames packed(frames, width, height, AlpFrames::PixelFormat::Binary);
+
+	std::mt19937 random(42);
+	for (long frame = 0; frame < frames; frame++) {
+		char unsigned* pixels = gray(frame);
+		for (size_t i = 0; i < gray.frameBytes(); i++)
+			pixels[i] = (char unsigned)random();
+	}
+
+	AlpPackKernel const active = AlpPackActiveKernel();
+	_tprintf(_T("Packing %ldx%ld gray8 frames to binary, one core:\r\n"), width, height);
+	for (AlpPackKernel kernel : { AlpPackKernel::Scalar, AlpPackKernel::SSE2, AlpPackKernel::AVX2 }) {
+		if (!AlpPackSelectKernel(kernel))
+			continue;
+		// rows of 1920 pixels need no padding, so each frame is packed in one call
+		double const seconds = timePerRun([&]() {
+			for (long frame = 0; frame < frames; frame++)
+				AlpPackRow(gray.frame(frame), packed.frame(frame), width * height, 128);
+		});
+		double const bytes = (double)gray.frameBytes() * frames;
+		std::printf("  %-6s %7.2f GB/s  %9.0f frames/s\r\n", AlpPackKernelName(kernel),
+			bytes / seconds / 1e9, frames / seconds);
+	}
+	AlpPackSelectKernel(active);
+}
+
+/**
+* @brief Measures how fast each available kernel slices 1920x1080 gray frames into 8 binary bit planes.
+*
+* Reports the input throughput in GB/s on one core and the resulting gray frame rate. The
+* kernel is called on this thread, since sliceFrom spreads the frames over all cores.
+*/
+void benchmarkSlicing() {
+	long const frames = 16, width = 1920, height = 1080, bitPlanes = 8;
+	AlpFrames gray(frames, width, height);
+	AlpFrames planes(frames * bitPlanes, width, height, AlpFrames::PixelFormat::Binary);
+
+	std::mt19937 random(42);
+	for (long frame = 0; frame < frames; frame++) {
+		char unsigned* pixels = gray(frame);
+		for (size_t i = 0; i < gray.frameBytes(); i++)
+			pixels[i] = (char unsigned)random();
+	}
+
+	AlpPackKernel const active = AlpPackActiveKernel();
+	_tprintf(_T("Slicing %ldx%ld gray8 frames into %ld bit planes, one core:\r\n"), width, height, bitPlanes);
+	for (AlpPackKernel kernel : { AlpPackKernel::Scalar, AlpPackKernel::SSE2, AlpPackKernel::AVX2 }) {
+		if (!AlpPackSelectKernel(kernel))
+			continue;
+		double const seconds = timePerRun([&]() {
+			char unsigned* targets[8];
+			for (long frame = 0; frame < frames; frame++) {
+				for (long k = 0; k < bitPlanes; k++)
+					targets[k] = planes.frame(frame * bitPlanes + k);
+				AlpSliceRow(gray.frame(frame), targets, width * height, bitPlanes);
+			}
+		});
+		double const bytes = (double)gray.frameBytes() * frames;
+		std::printf("  %-6s %7.2f GB/s  %9.0f frames/s\r\n", AlpPackKernelName(kernel),
+			bytes / seconds / 1e9, frames / seconds);
+	}
+	AlpPackSelectKernel(active);
+}
+
+/**
+* @brief Measures every AlpFrames primitive and pattern at 1024x768, 1920x1080 and 2560x1600 with 1 to 10000 frames.
+*
+* @param jsonPath File the results are written to, one object per case (see below).
+* @param maxBytes Cases whose frames need more memory are skipped (and reported as skipped).
+*
+* Every case draws into frames allocated up front, as renderSequence does; the patterns
+* use all cores through renderFrames. Reported per case: ns per pixel, GB/s of frame data
+* written (read, for packFrom and contentHash), and heap allocations per run, which should
+* stay independent of the frame size. A table is printed as well.
+*
+* @return int, 0 on success, otherwise 1 if the JSON file cannot be written.
+*/
+int benchmarkFrames(const char* jsonPath, const size_t maxBytes) {
+	typedef AlpFrames::PixelFormat Format;
+	long const sizes[][2] = { { 1024, 768 }, { 1920, 1080 }, { 2560, 1600 } };
+	long const frameCounts[] = { 1, 10, 100, 1000, 10000 };
+	std::vector<FramesCase> const cases = {
+		{ "fillRect", Format::Gray8, 1, everyFrame([](AlpFrames& f) { f.fillRect(0, f._width / 4, f._height / 4, f._width / 2, f._height / 2, 255); }) },
+		{ "fillRect", Format::Binary, 1, everyFrame([](AlpFrames& f) { f.fillRect(0, f._width / 4, f._height / 4, f._width / 2, f._height / 2, 255); }) },
+		{ "drawSquare", Format::Binary, 1, everyFrame([](AlpFrames& f) { f.drawSquare(1, f._height / 4, f._width / 4, f._height / 2); }) },
+		{ "drawVertialLines", Format::Binary, 1, everyFrame([](AlpFrames& f) { f.drawVertialLines(1, 0, 16, 4); }) },
+		{ "drawHorizontalLines", Format::Binary, 1, everyFrame([](AlpFrames& f) { f.drawHorizontalLines(1, 0, 16, 4); }) },
+		{ "drawGrid", Format::Binary, 1, everyFrame([](AlpFrames& f) { f.drawGrid(1, 0, 0, 16, 16, 4); }) },
+		{ "drawCheckerBoard", Format::Gray8, 1, everyFrame([](AlpFrames& f) { f.drawCheckerBoard(1, 0, 0, 20); }) },
+		{ "drawCheckerBoard", Format::Binary, 1, everyFrame([](AlpFrames& f) { f.drawCheckerBoard(1, 0, 0, 20); }) },
+		{ "drawGrayRamp", Format::Gray8, 1, everyFrame([](AlpFrames& f) { f.drawGrayRamp(1, 8); }) },
+		{ "drawMovingSquare", Format::Binary, 2, [](AlpFrames& f, AlpFrames&) { f.drawMovingSquare(f._frameCount, f._width, f._height); } },
+		{ "packFrom", Format::Binary, 1, [](AlpFrames& f, AlpFrames& gray) { f.packFrom(gray); } },
+		{ "contentHash", Format::Binary, 1, [](AlpFrames& f, AlpFrames&) { volatile unsigned long long hash = f.contentHash(); (void)hash; } },
+	};
+
+	std::FILE* const json = std::fopen(jsonPath, "w");
+	if (json == nullptr) {
+		std::fprintf(stderr, "Error: Cannot write %s.\n", jsonPath);
+		return 1;
+	}
+	std::fprintf(json, "{\"threads\":%u,\"results\":[", std::thread::hardware_concurrency());
+	std::printf("%-20s %-6s %9s %6s %9s %8s %11s\r\n", "primitive", "format", "size", "frames", "ns/pixel", "GB/s", "allocs/run");
+
+	bool first = true;
+	for (auto const& size : sizes)
+		for (long const frames : frameCounts)
+			for (auto const& benchmark : cases) {
+				long const width = size[0], height = size[1];
+				bool const needsGray = benchmark.format == Format::Binary && std::string(benchmark.name) == "packFrom";
+				size_t const frameBytes = (size_t)(benchmark.format == Format::Binary ? AlpFrames::binaryRowBytes(width) : width) * height;
+				size_t const bytes = frameBytes * frames + (needsGray ? (size_t)width * height * frames : 0);
+				char const* const format = benchmark.format == Format::Binary ? "binary" : "gray8";
+				std::string const label = std::to_string(width) + "x" + std::to_string(height);
+				if (frames < benchmark.minFrames)
+					continue;
+				if (bytes > maxBytes) {
+					std::fprintf(json, "%s\n{\"primitive\":\"%s\",\"format\":\"%s\",\"width\":%ld,\"height\":%ld,\"frames\":%ld,\"skipped\":true}",
+						first ? "" : ",", benchmark.name, format, width, height, frames);
+					first = false;
+					continue;
+				}
+
+				AlpFrames target(frames, width, height, benchmark.format);
+				AlpFrames gray(needsGray ? frames : 1, width, height);
+				if (needsGray) {
+					std::mt19937 random(42);
+					for (long frame = 0; frame < frames; frame++)
+						for (size_t i = 0; i < gray.frameBytes(); i++)
+							gray(frame)[i] = (char unsigned)random();
+				}
+
+				unsigned long long runs = 0;
+				unsigned long long const allocationsBefore = benchmarkAllocations();
+				double const seconds = timePerRun([&]() { benchmark.run(target, gray); runs++; }, 0.1);
+				double const allocations = (double)(benchmarkAllocations() - allocationsBefore) / runs;
+				double const pixels = (double)width * height * frames;
+				double const dataBytes = needsGray ? (double)gray.frameBytes() * frames : (double)frameBytes * frames;
+				double const nsPerPixel = seconds * 1e9 / pixels, gbPerSecond = dataBytes / seconds / 1e9;
+
+				std::printf("%-20s %-6s %9s %6ld %9.3f %8.2f %11.1f\r\n", benchmark.name, format, label.c_str(), frames,
+					nsPerPixel, gbPerSecond, allocations);
+				std::fprintf(json, "%s\n{\"primitive\":\"%s\",\"format\":\"%s\",\"width\":%ld,\"height\":%ld,\"frames\":%ld,"
+					"\"ns_per_pixel\":%.4f,\"gb_per_s\":%.4f,\"allocations_per_run\":%.1f,\"seconds_per_run\":%.6f}",
+					first ? "" : ",", benchmark.name, format, width, height, frames, nsPerPixel, gbPerSecond, allocations, seconds);
+				first = false;
+			}
+
+	std::fprintf(json, "\n]}\n");
+	bool const failed = std::ferror(json) != 0;
+	std::fclose(json);
+	if (failed) {
+		std::fprintf(stderr, "Error: Cannot write %s.\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+* @brief Measures AlpDecodePatterns on synthetic captures of the XGA structured-light set.
+*
+* @param cameraWidth, cameraHeight The camera resolution.
+*
+* Column and row Gray-code sets with inverses and two 4-step phase-shift sets (period 32) are
+* drawn as gray8 frames, as `--structured` projects them, and rendered onto a plane with a
+* dome 12 projector pixels high, seen by a camera covering 80% of the projector width with
+* 4 gray levels of noise (AlpSynthesizeCaptures). Each axis is decoded with and without phase
+* refinement; reported are the throughput on all cores, the valid pixels, and the error
+* against the true projector positions.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int benchmarkDecoding(const long cameraWidth, const long cameraHeight) {
+	long const projectorWidth = 1024, projectorHeight = 768, steps = 4, period = 32;
+	long const columnBits = AlpFrames::grayCodeBits(projectorWidth), rowBits = AlpFrames::grayCodeBits(projectorHeight);
+	long const patternCount = 2 * columnBits + 2 * rowBits + 2 * steps;
+	if (cameraWidth < 1 || cameraHeight < 1) {
+		std::fprintf(stderr, "Error: Invalid camera resolution.\n");
+		return 1;
+	}
+
+	AlpFrames patterns(patternCount, projectorWidth, projectorHeight);
+	if (patterns.drawGrayCode(0, columnBits, true) != 0 || patterns.drawGrayCode(2 * columnBits, rowBits, false) != 0
+		|| patterns.drawPhaseShift(2 * columnBits + 2 * rowBits, steps, period, true) != 0
+		|| patterns.drawPhaseShift(2 * columnBits + 2 * rowBits + steps, steps, period, false) != 0)
+		return 1;
+
+	double const scale = 0.8 * projectorWidth / cameraWidth;
+	tAlpSyntheticScene const scene{ scale, 0.1 * projectorWidth, (projectorHeight - scale * cameraHeight) / 2, 12., 20., 200., 4. };
+	AlpFrames captures(patternCount, cameraWidth, cameraHeight);
+	auto const start = Clock::now();
+	if (AlpSynthesizeCaptures(patterns, captures, scene) != 0)
+		return 1;
+	_tprintf(_T("Decoding %ld synthetic %ldx%ld captures (rendered in %0.0f ms), %u threads:\r\n"), patternCount,
+		cameraWidth, cameraHeight, std::chrono::duration<double, std::milli>(Clock::now() - start).count(),
+		AlpThreadPool::shared().concurrency());
+
+	struct DecodeCase {
+		const char* name;
+		bool columns;
+		tAlpPatternSet set;
+	};
+	DecodeCase const cases[] = {
+		{ "columns", true, { 0, columnBits, projectorWidth, -1, 0, 0 } },
+		{ "columns+phase", true, { 0, columnBits, projectorWidth, 2 * columnBits + 2 * rowBits, steps, period } },
+		{ "rows", false, { 2 * columnBits, rowBits, projectorHeight, -1, 0, 0 } },
+		{ "rows+phase", false, { 2 * columnBits, rowBits, projectorHeight, 2 * columnBits + 2 * rowBits + steps, steps, period } },
+	};
+	std::printf("  %-14s %8s %8s %10s %12s\r\n", "set", "MP/s", "valid", "rms [px]", "<0.5 px");
+	std::vector<float> positions;
+	for (DecodeCase const& c : cases) {
+		tAlpDecodeStats stats{};
+		double const seconds = timePerRun([&]() { AlpDecodePatterns(captures, c.set, positions, stats); });
+		double squares = 0;
+		unsigned long long close = 0;
+		for (long v = 0; v < cameraHeight; v++)
+			for (long u = 0; u < cameraWidth; u++) {
+				float const position = positions[(size_t)v * cameraWidth + u];
+				if (position < 0)
+					continue;
+				double x, y;
+				AlpSceneToProjector(scene, cameraWidth, cameraHeight, u, v, x, y);
+				double const error = position - (c.columns ? x : y);
+				squares += error * error;
+				close += std::abs(error) < 0.5;
+			}
+		double const valid = std::max(stats.Valid, 1ULL);
+		std::printf("  %-14s %8.1f %7.1f%% %10.3f %11.2f%%\r\n", c.name, stats.Pixels / seconds / 1e6,
+			100. * stats.Valid / stats.Pixels, std::sqrt(squares / valid), 100. * close / valid);
+	}
+	return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+/**
+* @file Benchmark.h
+*
+* @brief Micro-benchmarks of the host-side render and upload path, started with `--bench`.
+*/
+
+#include <cstddef>
+
+// Throughput of every gray8-to-binary kernel the CPU supports, single-threaded
+void benchmarkPacking();
+
+// Throughput of every gray8 bit-plane slicing kernel the CPU supports, single-threaded
+void benchmarkSlicing();
+
+// Heap allocations of the whole program so far, see BenchmarkAllocations.cpp
+unsigned long long benchmarkAllocations();
+
+// Cost of every AlpFrames primitive and pattern at common DMD sizes and frame counts, written as JSON to `jsonPath`
+int benchmarkFrames(const char* jsonPath, const size_t maxBytes = (size_t)1 << 30);
+
+// Throughput and accuracy of the structured-light decoder on synthetic captures of the given camera resolution
+int benchmarkDecoding(const long cameraWidth, const long cameraHeight);
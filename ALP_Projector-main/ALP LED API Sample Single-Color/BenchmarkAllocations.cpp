@@ -0,0 +1,38 @@
+/**
+* @file BenchmarkAllocations.cpp
+*
+* @brief Counts heap allocations for benchmarkFrames, by replacing the global allocation functions.
+*
+* The replacement affects the whole program; a relaxed increment costs nothing next to the
+* allocation itself. Kept apart from Benchmark.cpp so no caller sees the definitions inline.
+*/
+
+#include "Benchmark.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<unsigned long long> gAllocations(0);
+
+}
+
+unsigned long long benchmarkAllocations() {
+	return gAllocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+	gAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* const p = std::malloc(size != 0 ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// Minimal stand-ins for the Win32 and MSVC CRT facilities used by this project,
+// so it can be built against the ALP emulator (AlpEmulator.h) on Linux.
+// Only included by stdafx.h when _WIN32 is not defined.
+
+#include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <sys/select.h>
+#include <unistd.h>
+
+typedef char TCHAR;
+typedef char* LPTSTR;
+typedef const char* LPCTSTR;
+
+#define _T(x) x
+#define _tprintf printf
+#define _tscanf_s scanf
+#define _totlower tolower
+#define _sntprintf_s(buffer, size, count, ...) snprintf(buffer, size, __VA_ARGS__)
+#define _TRUNCATE ((size_t)-1)
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+#define _ASSERT(expr) assert(expr)
+
+#define VK_ESCAPE 0x1B
+#define MAKELONG(low, high) ((long)(((unsigned short)(low)) | (((unsigned long)((unsigned short)(high))) << 16)))
+
+inline void Sleep(unsigned long milliseconds) {
+	usleep(milliseconds * 1000);
+}
+
+// Set once stdin has reached its end, after which no further key presses can arrive
+inline bool& StdinAtEnd() {
+	static bool atEnd = false;
+	return atEnd;
+}
+
+// Non-blocking check for pending input on stdin. A closed or redirected stdin
+// counts as one key press, so headless runs never wait on the console.
+inline int _kbhit() {
+	if (StdinAtEnd())
+		return 0;
+	fd_set readSet;
+	timeval timeout = { 0, 0 };
+	FD_ZERO(&readSet);
+	FD_SET(STDIN_FILENO, &readSet);
+	return select(STDIN_FILENO + 1, &readSet, nullptr, nullptr, &timeout) > 0;
+}
+
+// Reads one character. End of input is reported as ESC, which the prompts treat as "cancel".
+inline int _gettch() {
+	int c = getchar();
+	if (c == EOF)
+		StdinAtEnd() = true;
+	return c == EOF ? VK_ESCAPE : c;
+}
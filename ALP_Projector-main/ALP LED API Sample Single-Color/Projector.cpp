@@ -12,15 +12,36 @@
 * - generatePattern: Initializes the image data and allocates memory for the image sequence.
 *   It also sets the timing properties of the sequence, loads user-supplied data into the
 *   ALP memory of a previously allocated sequence.
+* - renderSequence: Renders frames on several threads while they are uploaded (AlpUploader).
+* - setAreaOfInterest, selectRows: Restrict sequences to a band of DMD rows (ALP_SEQ_DMD_LINES).
+* - setBitNum, selectBitNum: Display fewer bit planes of gray sequences for higher frame rates (ALP_BITNUM).
+* - cachedSequence, switchSequence: Keep uploaded patterns resident and switch between them
+*   without rendering or uploading again.
+* - updateSequence: Loads only the frames modified since a sequence was loaded (AlpFrames::generation).
 * - initializeLED: Initializes the LED and inquires the LED's brightness.
+* - setTelemetry, getLEDTelemetry: Sample the LED current and temperature on a background thread (AlpLedTelemetry).
 * - gatedSynch: Certain ViALUX single-LED devices have a LED enable connected to Gated Synch 3
 *   This method asserts this signal permanently
 * - display: Start the continuous display and monitor LED current and temperature.
+* - setThermalLimit: Derate the LED brightness during display to keep the junction below a ceiling.
+* - requestStop, requestSequence, requestBrightness: Control a running display from any thread (AlpCommandQueue).
+* - projectFrames: Projects frames rendered by the caller, e.g. gray images.
+* - fileSequence, projectFiles: Load memory-mapped image files and pre-packed sequence files
+*   (AlpImageFiles) straight from their pages.
+* - scrollPattern: Projects a moving pattern by letting the ALP scroll through one tall strip
+*   (line scrolling) instead of uploading a frame per position.
+* - VERIFY_ALP, VERIFY_ALP_NO_ECHO: Record the latency of every ALP call (AlpProfiler).
+* - startStreaming, streamPattern, stopStreaming: Gapless projection of an unbounded series of
+*   sequences, uploading the next one while the previous one is displayed.
+* - streamInput: Streams frames read from stdin or a FIFO, written by another process.
+* - projectTriggered: Advances frames in lockstep with a camera through the trigger input
+*   (ALP_PROJ_STEP or ALP_SLAVE), e.g. for structured-light capture.
 */
 
 #include "Projector.h"
 
 Projector::~Projector() {
+	_telemetry.stop();
 	try {
 		AlpDevHalt(AlpDevId);
 		AlpDevFree(AlpDevId);
@@ -42,10 +63,14 @@ Projector::~Projector() {
 * @return  int, representing the status of the initialization, returns 0 if initialization was successful, otherwise returns an error code.
 */
 int Projector::initializeProjector() {
+	if (_deviceAllocated)
+		return 0;
 	try {
 		VERIFY_ALP_NO_ECHO(AlpDevAlloc(deviceNum, initFlag, &AlpDevId));
 		VERIFY_ALP_NO_ECHO(AlpDevInquire(AlpDevId, ALP_DEV_DISPLAY_WIDTH, &_width));
 		VERIFY_ALP_NO_ECHO(AlpDevInquire(AlpDevId, ALP_DEV_DISPLAY_HEIGHT, &_height));
+		_deviceAllocated = true;
+		VERIFY_ALP_RESULT(_memory.attach(AlpDevId));
 	}
 	catch (std::invalid_argument const& e) {
 		std::cerr << "Error: " << e.what() << std::endl;
@@ -53,6 +78,13 @@ int Projector::initializeProjector() {
 	}
 	_tprintf(_T("Projector dimensions: %i x %i pixels\r\n"), _width, _height);
 
+	// evicted sequences must not be handed out by the cache any more
+	_memory.setEvictionHandler([this](ALP_ID seqId) {
+		for (auto it = _sequenceCache.begin(); it != _sequenceCache.end(); )
+			it = it->second.sequenceId == seqId ? _sequenceCache.erase(it) : std::next(it);
+		_uploads.erase(seqId);
+	});
+
 	return 0;
 }
 
@@ -64,10 +96,10 @@ int Projector::initializeProjector() {
 * @param pictureTime The time it takes to display each picture in the nanoseconds.
 * @param brightness The brightness of the projected image in %.
 *
-* This method generates a pattern by initializing the
-* image data using the CAlpFramesMovingSquare class. The method then allocates a sequence,
-* loads the data into the ALP memory and sets the timing properties of the sequence using the
-* AlpSeqAlloc, AlpSeqPut and AlpSeqTiming functions of the ALP-4 API.
+* This method generates a pattern by drawing each frame using the AlpFrames class, packed to
+* one bit per pixel for binary sequences. Frames are loaded into the ALP memory while the
+* following ones are still being drawn (see renderSequence). If the same pattern has been
+* generated before, its sequence is still on the device and is projected again right away.
 * It also call other function to drive LED,  set gatedSynch and start display
 *
 * @note AlpSeqAlloc: allocates a sequence.
@@ -85,20 +117,20 @@ int Projector::generatePattern(const long frames, const long spacing, const unsi
 
 	setImageDataParams(frames, spacing, pictureTime, brightness);
 
-	AlpFrames Image(_frames, _width, _height);
-	//Image.drawSquare(_frames, 0, 0, _width, _height, 100);
-	//Image.drawMovingSquare(_frames, _width, _height);
-	//Image.drawVertialLines(_frames, 0, 10, _width, _height, 2);
-	//Image.drawHorizontalLines(_frames, 0, 10, _width, _height, 2);
-	//Image.drawGrid(_frames, 0, 0, 10, 10, 2);
-	Image.drawCheckerBoard(_frames, 20, 0, 50);
-	//Image.fillRect(1, 50, 50, 5, 5, 255);
-	//Image.at(1, 50, 50);
-	//Image.fillRect(1, 10, 10, 10, 10, 255);
-
-	VERIFY_ALP_NO_ECHO(AlpSeqAlloc(AlpDevId, _bitPlanes, _frames, &AlpSeqId));
-	VERIFY_ALP_NO_ECHO(AlpSeqPut(AlpDevId, AlpSeqId, _pictureOffset, _frames, Image(0)));
-	VERIFY_ALP_NO_ECHO(AlpSeqTiming(AlpDevId, AlpSeqId, _illuminateTime, _pictureTime, _synchDelay, _synchPulseWidth, _triggerInDelay));
+	// `frame` holds the single frame being rendered; every frame shows the same pattern
+	std::atomic<int> failed(0);
+	auto const draw = [&failed](AlpFrames& frame, long) {
+		//failed |= frame.drawSquare(1, 0, 0, 100);
+		//failed |= frame.drawVertialLines(1, 0, 10, 2);
+		//failed |= frame.drawHorizontalLines(1, 0, 10, 2);
+		//failed |= frame.drawGrid(1, 0, 0, 10, 10, 2);
+		failed |= frame.drawCheckerBoard(1, 20, 0, 50);
+		//failed |= frame.fillRect(0, 50, 50, 5, 5, 255);
+		//failed |= frame.fillRect(0, 10, 10, 10, 10, 255);
+	};
+
+	if (cachedSequence(patternKey("CheckerBoard", { 20, 0, 50 }), draw, AlpSeqId) != 0 || failed != 0)
+		return 1;
 
 	initializeLED();
 
@@ -107,22 +139,1030 @@ int Projector::generatePattern(const long frames, const long spacing, const unsi
 	return 0;
 }
 
+/**
+* @brief Projects a moving pattern by scrolling a window of one DMD height through `strip`.
+*
+* @param strip Frames forming one tall image (see AlpFrames::fillStripRect), with the DMD dimensions.
+* Gray8 frames for a 1-bit sequence are thresholded and packed first.
+* @param fromRow, toRow Strip rows at the top of the first and last displayed frame.
+* @param lineInc Rows the window moves down per displayed frame.
+*
+* Each displayed frame shows rows [row, row + DMD height) of the strip. Only the frames of
+* the strip are uploaded, e.g. 2 frames for a bar crossing the DMD (AlpFrames::drawScrollingBar)
+* instead of one frame per bar position, which saves sequence memory and upload time in
+* proportion. The strip is kept resident like other sequences (see cachedSequence).
+*
+* @note AlpSeqControl(ALP_SCROLL_FROM_ROW, ALP_SCROLL_TO_ROW): combined frame and line positions,
+* i.e. frame * DMD height + line.
+* @note AlpSeqControl(ALP_LINE_INC): enables line scrolling; each picture time the window moves down by this many rows.
+*
+* @return int, 0 if the function executed successfully, otherwise 1.
+*/
+int Projector::scrollPattern(AlpFrames& strip, const long fromRow, const long toRow, const long lineInc) {
+	if (initializeProjector() != 0)
+		return 1;
+
+	try {
+		if (strip._width != _width || strip._height != _height || strip._firstRow != 0)
+			throw std::invalid_argument("Error: Strip and DMD dimensions differ.");
+		if (lineInc <= 0 || lineInc > _height)
+			throw std::invalid_argument("Error: `lineInc` must be between 1 and the DMD height.");
+		if (fromRow < 0 || fromRow > toRow || toRow + _height > strip._frameCount * _height)
+			throw std::invalid_argument("Error: The scrolled window must stay within the strip.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	ALP_ID seqId;
+	if (cachedSequence(strip, seqId) != 0)
+		return 1;
+	VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_SCROLL_FROM_ROW, fromRow));
+	VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_SCROLL_TO_ROW, toRow));
+	VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_LINE_INC, lineInc));
+	_tprintf(_T("Scrolling: %i displayed frames from %i uploaded frames\r\n"),
+		(toRow - fromRow) / lineInc + 1, strip._frameCount);
+
+	initializeLED();
+
+	AlpSeqId = seqId;
+	return display();
+}
+
+/**
+* @brief Projects already rendered frames, uploading them only if they are not resident yet.
+*
+* @param image The frames, e.g. Gray8 frames for a sequence of several bit planes (see
+* setSequenceParams). Gray8 frames for a 1-bit sequence are thresholded and packed first.
+*
+* @return int, 0 if the function executed successfully, otherwise 1.
+*/
+int Projector::projectFrames(AlpFrames& image) {
+	if (initializeProjector() != 0)
+		return 1;
+	if (cachedSequence(image, AlpSeqId) != 0)
+		return 1;
+
+	initializeLED();
+
+	return display();
+}
+
+/**
+* @brief Projects all frames of memory-mapped image files, see fileSequence.
+*
+* @return int, 0 if the function executed successfully, otherwise 1.
+*/
+int Projector::projectFiles(AlpImageFiles& files) {
+	if (fileSequence(files, AlpSeqId) != 0)
+		return 1;
+
+	initializeLED();
+
+	return display();
+}
+
+/**
+* @brief Projects the frames of `image` once, advancing in lockstep with the trigger input, e.g. a camera's exposure output.
+*
+* @param image The frames, as for projectFrames.
+* @param mode ALP_PROJ_STEP: the first frame is shown at once, every trigger advances to the
+* next one, and the trigger after the last frame ends the projection, i.e. one trigger per frame
+* at the end of its exposure. ALP_SLAVE: every frame starts `triggerInDelay` (setTimingParams)
+* after a trigger and is shown for the illumination time.
+* @param condition ALP_EDGE_RISING or ALP_EDGE_FALLING; with ALP_PROJ_STEP also ALP_LEVEL_HIGH or ALP_LEVEL_LOW.
+* @param started Called once the projection waits for triggers, e.g. to start the camera.
+* @param triggerCount Optional, returns the triggers sent so far, e.g. the exposures of the camera.
+* Called when the projection ends; the triggers beyond the frames completed count as missed.
+*
+* A frame is shown for at least the picture time. A trigger arriving earlier is stored by the
+* ALP and a further one is lost, so the picture time bounds the capture rate; an area of
+* interest or fewer bit planes lower it (getMinPictureTime). Synch output 1 pulses for every
+* frame (ALP_DEV_DYN_SYNCH_OUT1_GATE), `synchDelay` before it is displayed.
+*
+* Ends when all frames have been shown, on requestStop, or as display does (key press,
+* `_runTime`). Brightness requests are applied, sequence requests ignored. The continuous
+* projection started before is halted.
+*
+* @note AlpProjControl(ALP_PROJ_STEP, condition): master timing, but each frame is repeated until a trigger.
+* @note AlpProjControl(ALP_PROJ_MODE, ALP_SLAVE), AlpDevControl(ALP_TRIGGER_EDGE): every frame waits for a trigger.
+* @note AlpProjInquireEx(ALP_PROJ_PROGRESS): frames of the sequence not yet finished, for the frames shown.
+* @note The ALP does not report the latency from a trigger to its frame; the emulator measures
+* it (AlpEmuTriggerStats), on hardware it needs the synch output and the trigger on a scope.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::projectTriggered(AlpFrames& image, const long mode, const long condition, std::function<void()> const& started,
+	std::function<unsigned long long()> const& triggerCount) {
+	if (initializeProjector() != 0)
+		return 1;
+	try {
+		if (mode != ALP_PROJ_STEP && mode != ALP_SLAVE)
+			throw std::invalid_argument("Error: Triggered projection needs ALP_PROJ_STEP or ALP_SLAVE.");
+		if (condition != ALP_EDGE_RISING && condition != ALP_EDGE_FALLING &&
+			(mode == ALP_SLAVE || (condition != ALP_LEVEL_HIGH && condition != ALP_LEVEL_LOW)))
+			throw std::invalid_argument("Error: Invalid trigger condition.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	ALP_ID seqId;
+	if (cachedSequence(image, seqId) != 0)
+		return 1;
+	initializeLED();
+
+	// the frame synch of every picture appears at synch output 1
+	tAlpDynSynchOutGate frameGate;
+	memset(&frameGate, 0, sizeof(frameGate));
+	frameGate.Period = 1;
+	frameGate.Polarity = 1;
+	frameGate.Gate[0] = 1;
+	VERIFY_ALP_NO_ECHO(AlpDevControlEx(AlpDevId, ALP_DEV_DYN_SYNCH_OUT1_GATE, &frameGate));
+
+	VERIFY_ALP_NO_ECHO(AlpProjHalt(AlpDevId));
+	_memory.pin(_projectedSeqId, false);
+	_projectedSeqId = ALP_INVALID_ID;
+	_memory.pin(seqId, true);
+	_memory.touch(seqId);
+	if (mode == ALP_SLAVE) {
+		VERIFY_ALP_NO_ECHO(AlpDevControl(AlpDevId, ALP_TRIGGER_EDGE, condition));
+		VERIFY_ALP_NO_ECHO(AlpProjControl(AlpDevId, ALP_PROJ_MODE, ALP_SLAVE));
+	}
+	else {
+		VERIFY_ALP_NO_ECHO(AlpProjControl(AlpDevId, ALP_PROJ_STEP, condition));
+	}
+
+	AlpTraceSpan span("project");
+	std::jthread keyWatcher = _interactive ? watchKeyboard() : std::jthread();
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point const start = Clock::now(), end = start + std::chrono::milliseconds(_runTime);
+	VERIFY_ALP_NO_ECHO(AlpProjStart(AlpDevId, seqId));
+	if (started)
+		started();
+
+	// the projection state is polled every millisecond, requests wake the loop at once
+	long state = ALP_PROJ_ACTIVE;
+	for (bool stop = false; !stop; ) {
+		tAlpCommand command;
+		if (_commands.wait(command, Clock::now() + std::chrono::milliseconds(1))) {
+			stop = command.Type == AlpCommand::Stop;
+			if (command.Type == AlpCommand::Brightness) {
+				setBrightness(command.Value);
+				VERIFY_ALP_NO_ECHO(AlpLedControl(AlpDevId, AlpLedId, ALP_LED_BRIGHTNESS, command.Value));
+			}
+			_commands.done(command);
+			continue;
+		}
+		VERIFY_ALP_NO_ECHO(AlpProjInquire(AlpDevId, ALP_PROJ_STATE, &state));
+		stop = state != ALP_PROJ_ACTIVE || (!_interactive && Clock::now() >= end);
+	}
+	_triggeredTime = (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+	unsigned long long const triggers = triggerCount ? triggerCount() : 0;
+	keyWatcher = std::jthread();
+
+	_triggeredFrames = image._frameCount;
+	unsigned long startedFrames = image._frameCount;
+	if (state == ALP_PROJ_ACTIVE) {
+		tAlpProjProgress progress;
+		VERIFY_ALP_NO_ECHO(AlpProjInquireEx(AlpDevId, ALP_PROJ_PROGRESS, &progress));
+		_triggeredFrames = image._frameCount - progress.nFrameCounter;
+		// in slave mode, the frame being shown was started by a trigger as well
+		startedFrames = _triggeredFrames;
+		if (mode == ALP_SLAVE && (_triggeredFrames > 0 || triggers > 0))
+			startedFrames = std::min(_triggeredFrames + 1, (unsigned long)image._frameCount);
+	}
+	// every frame took one trigger: the one ending it (step) or starting it (slave)
+	_missedTriggers = (unsigned long)(triggers > startedFrames ? triggers - startedFrames : 0);
+	VERIFY_ALP_NO_ECHO(AlpProjHalt(AlpDevId));
+	if (mode == ALP_SLAVE) {
+		VERIFY_ALP_NO_ECHO(AlpProjControl(AlpDevId, ALP_PROJ_MODE, ALP_MASTER));
+	}
+	else {
+		VERIFY_ALP_NO_ECHO(AlpProjControl(AlpDevId, ALP_PROJ_STEP, ALP_DEFAULT));
+	}
+	_memory.pin(seqId, false);
+
+	_tprintf(_T("Triggered projection: %lu of %li frames in %0.1f ms, %0.1f frames/s"), _triggeredFrames, image._frameCount,
+		_triggeredTime / 1000., _triggeredTime == 0 ? 0. : _triggeredFrames * 1e6 / _triggeredTime);
+	if (triggerCount)
+		_tprintf(_T(", %llu triggers, %lu missed"), triggers, _missedTriggers);
+	_tprintf(_T("\r\n"));
+	return 0;
+}
+
+/**
+* @brief Allocates a sequence of `_frames` frames and renders them while they are being uploaded.
+*
+* Sequences are allocated through the sequence memory manager, which frees the least
+* recently projected sequences if the on-board memory is full.
+*
+* @param render Called once per frame with an AlpFrames holding just that frame (cleared) and
+* its frame number. It is called from several threads at once.
+* @param[out] seqId The identifier of the new sequence.
+* @param threads The number of render threads, 0 for one per CPU core besides the upload thread.
+*
+* With an area of interest (see setAreaOfInterest), frames only hold its rows.
+*
+* Frames are rendered directly into the slots of an AlpUploader, whose thread loads them with
+* AlpSeqPut as soon as they are complete. The first frames are on the device while the last
+* ones are still rendered, so loading takes max(render, transfer) instead of their sum.
+*
+* @return int, 0 if the sequence was uploaded successfully, otherwise 1.
+*/
+int Projector::renderSequence(std::function<void(AlpFrames&, long)> const& render, ALP_ID& seqId, unsigned threads) {
+	AlpFrames::PixelFormat const format = _bitPlanes == 1 ? AlpFrames::PixelFormat::Binary : AlpFrames::PixelFormat::Gray8;
+	long const rows = activeRows();
+	size_t const frameBytes = (size_t)(_bitPlanes == 1 ? AlpFrames::binaryRowBytes(_width) : _width) * rows;
+	if (threads == 0)
+		threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	VERIFY_ALP_RESULT(_memory.alloc(_bitPlanes, _frames, &seqId));
+	if (format == AlpFrames::PixelFormat::Binary)
+		VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_DATA_FORMAT, ALP_DATA_BINARY_TOPDOWN));
+	if (selectBitNum(seqId) != 0 || selectRows(seqId, _aoiFirstRow, rows) != 0)
+		return 1;
+	VERIFY_ALP_NO_ECHO(AlpSeqTiming(AlpDevId, seqId, _illuminateTime, _pictureTime, _synchDelay, _synchPulseWidth, _triggerInDelay));
+
+	AlpUploader uploader(AlpDevId, seqId, _frames, frameBytes, _pictureOffset);
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < threads; i++)
+		workers.emplace_back([&]() {
+			char unsigned* data;
+			for (long frameNum; (frameNum = uploader.acquire(data)) >= 0; ) {
+				AlpTraceSpan span("render");
+				AlpFrames frame(data, 1, _width, rows, format, _aoiFirstRow);
+				render(frame, frameNum);
+				uploader.commit(frameNum);
+			}
+		});
+	for (auto& worker : workers)
+		worker.join();
+	VERIFY_ALP_RESULT(uploader.finish());
+
+	_tprintf(_T("Sequence loaded: first frame after %0.1f ms, %i frames after %0.1f ms\r\n"),
+		uploader.timeToFirstFrame() * 1000, _frames, uploader.loadTime() * 1000);
+	return 0;
+}
+
+/**
+* @brief Returns the resident sequence for `key`, rendering and uploading it only on first use.
+*
+* @param key Identifies the content of the sequence, see patternKey. Equal keys must render equal frames.
+* @param render Draws frame `frameNum`, as for renderSequence. Not called if the sequence is cached.
+* @param[out] seqId The identifier of the (cached) sequence.
+*
+* Sequences stay allocated in the ALP memory, so recurring patterns (e.g. calibration
+* patterns) only cost an AlpProjStart. If the timing parameters or ALP_BITNUM changed since
+* the sequence was uploaded, they are applied again; no frame data is transferred.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::cachedSequence(const unsigned long long key, std::function<void(AlpFrames&, long)> const& render, ALP_ID& seqId) {
+	if (initializeProjector() != 0)
+		return 1;
+	if (_sequenceCache.count(key) != 0)
+		return cacheLookup(_sequenceCache[key], seqId);
+
+	_cacheMisses++;
+	if (renderSequence(render, seqId) != 0)
+		return 1;
+	_sequenceCache[key] = CachedSequence{ seqId, getTimingParams(), _bitNum };
+	return 0;
+}
+
+/**
+* @brief Returns the resident sequence of `image`, uploading it only if no sequence with these frames is resident.
+*
+* The key is the content hash of the frames (AlpFrames::contentHash) together with the bit
+* planes, so already rendered frames are recognized without knowing how they were drawn.
+* The sequence remembers `image` and a generation mark, so frames that have not been modified
+* since are found without hashing them again, and updateSequence can load just the modified ones.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::cachedSequence(AlpFrames& image, ALP_ID& seqId) {
+	if (initializeProjector() != 0)
+		return 1;
+	unsigned long long const mark = AlpFrames::generationMark();
+	long const bitPlanes = image._format == AlpFrames::PixelFormat::Binary ? 1 : _bitPlanes;
+	UploadedFrames* const uploaded = findUpload(image, bitPlanes);
+	bool modified = uploaded == nullptr;
+	for (long frameNum = 0; !modified && frameNum < image._frameCount; frameNum++)
+		modified = image.generation(frameNum) >= uploaded->mark;
+	if (!modified) {
+		uploaded->mark = mark;
+		return cacheLookup(uploaded->keyed ? _sequenceCache[uploaded->key] : uploaded->updated, seqId);
+	}
+
+	unsigned long long const key = image.contentHash() ^ ((unsigned long long)bitPlanes << 56);
+	if (_sequenceCache.count(key) != 0) {
+		if (cacheLookup(_sequenceCache[key], seqId) != 0)
+			return 1;
+	}
+	else {
+		_cacheMisses++;
+		if (uploadSequence(image, seqId) != 0)
+			return 1;
+		_sequenceCache[key] = CachedSequence{ seqId, getTimingParams(), _bitNum };
+	}
+	// equal keys mean equal frames, so a cache hit holds `image` as well
+	if (uploaded != nullptr)
+		uploaded->source = nullptr;
+	auto const previous = _uploads.find(seqId);
+	long const pictureOffset = previous != _uploads.end() ? previous->second.pictureOffset : _pictureOffset;
+	_uploads[seqId] = UploadedFrames{ &image, mark, key, true, CachedSequence{}, image._frameCount, image._width,
+		image._height, image._firstRow, bitPlanes, pictureOffset, image._format };
+	return 0;
+}
+
+/**
+* @brief Brings the resident sequence of `image` up to date, loading only the frames modified since it was loaded.
+*
+* @param image Frames loaded before by cachedSequence (e.g. through projectFrames) or updateSequence.
+* @param[out] seqId The identifier of the sequence.
+*
+* Each load takes a generation mark (AlpFrames::generationMark). Frames whose generation is at
+* least the mark have been modified since, and are loaded in runs of consecutive frames, with
+* one AlpSeqPut per run; Gray8 frames of a 1-bit sequence are packed run by run. Changing one
+* frame of a 5000-frame sequence thus transfers one frame, and nothing is hashed. If `image`
+* has no resident sequence (never loaded, evicted, or loaded with other bit planes), it is
+* loaded as a whole by cachedSequence.
+*
+* A sequence being projected is updated in place, so a frame may show partly old and partly
+* new content once. An updated sequence is no longer found by content, only through `image`.
+*
+* @note AlpSeqPut(PicOffset, PicLoad): loads pictures PicOffset to PicOffset + PicLoad - 1 of the sequence.
+* @note AlpSeqControl(ALP_SEQ_PUT_LOCK): any value but ALP_DEFAULT allows loading a sequence in use.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::updateSequence(AlpFrames& image, ALP_ID& seqId) {
+	if (initializeProjector() != 0)
+		return 1;
+	long const bitPlanes = image._format == AlpFrames::PixelFormat::Binary ? 1 : _bitPlanes;
+	UploadedFrames* const uploaded = findUpload(image, bitPlanes);
+	if (uploaded == nullptr)
+		return cachedSequence(image, seqId);
+
+	seqId = std::find_if(_uploads.begin(), _uploads.end(),
+		[uploaded](std::pair<const ALP_ID, UploadedFrames> const& entry) { return &entry.second == uploaded; })->first;
+	unsigned long long const mark = AlpFrames::generationMark();
+	bool const packed = bitPlanes == 1 && image._format == AlpFrames::PixelFormat::Gray8;
+	auto const start = std::chrono::steady_clock::now();
+
+	if (seqId == _projectedSeqId) {
+		VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_SEQ_PUT_LOCK, ALP_ENABLE));
+	}
+	long loaded = 0;
+	for (long first = 0; first < image._frameCount; ) {
+		if (image.generation(first) < uploaded->mark) {
+			first++;
+			continue;
+		}
+		long last = first + 1;
+		while (last < image._frameCount && image.generation(last) >= uploaded->mark)
+			last++;
+		long const count = last - first;
+		if (packed) {
+			AlpFrames gray(image(first), count, image._width, image._height, image._format, image._firstRow);
+			AlpFrames run(count, image._width, image._height, AlpFrames::PixelFormat::Binary, image._firstRow);
+			run.packFrom(gray);
+			AlpProfilerBytes(count * run.frameBytes());
+			VERIFY_ALP_NO_ECHO(AlpSeqPut(AlpDevId, seqId, uploaded->pictureOffset + first, count, run(0)));
+		}
+		else {
+			AlpProfilerBytes(count * image.frameBytes());
+			VERIFY_ALP_NO_ECHO(AlpSeqPut(AlpDevId, seqId, uploaded->pictureOffset + first, count, image(first)));
+		}
+		loaded += count;
+		first = last;
+	}
+	if (seqId == _projectedSeqId) {
+		VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_SEQ_PUT_LOCK, ALP_DEFAULT));
+	}
+	uploaded->mark = mark;
+
+	// the content hash no longer matches the frames
+	if (loaded > 0 && uploaded->keyed) {
+		uploaded->updated = _sequenceCache[uploaded->key];
+		_sequenceCache.erase(uploaded->key);
+		uploaded->keyed = false;
+	}
+	_updates++;
+	_updatedFrames += loaded;
+	_skippedFrames += image._frameCount - loaded;
+	_memory.touch(seqId);
+
+	_tprintf(_T("Sequence updated: %li of %li frames loaded in %0.1f ms\r\n"), loaded, image._frameCount,
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	return 0;
+}
+
+// The sequence last loaded from `image` with `bitPlanes`, if its geometry still matches; frames
+// constructed at the address of destroyed ones count as modified anyway
+Projector::UploadedFrames* Projector::findUpload(AlpFrames const& image, const long bitPlanes) {
+	for (auto& entry : _uploads) {
+		UploadedFrames& uploaded = entry.second;
+		if (uploaded.source == &image)
+			return uploaded.frameCount == image._frameCount && uploaded.width == image._width && uploaded.height == image._height
+				&& uploaded.firstRow == image._firstRow && uploaded.format == image._format && uploaded.bitPlanes == bitPlanes
+				? &uploaded : nullptr;
+	}
+	return nullptr;
+}
+
+/**
+* @brief Returns a resident 1-bit sequence holding the bit planes of the gray frames in `gray`.
+*
+* @param gray Gray8 frames.
+* @param bitPlanes Planes per gray frame, 1 to 8. Picture `f * bitPlanes + k` shows bit 7 - k of
+* gray frame `f` (see AlpFrames::sliceFrom).
+* @param[out] seqId The identifier of the (cached) sequence.
+*
+* Binary patterns encoded as the bits of gray images (e.g. Gray codes) are rendered once as
+* gray images and projected plane by plane at the binary frame rate.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::planeSequence(AlpFrames& gray, const long bitPlanes, ALP_ID& seqId) {
+	AlpFrames planes(gray._frameCount * bitPlanes, gray._width, gray._height, AlpFrames::PixelFormat::Binary, gray._firstRow);
+	planes.sliceFrom(gray, bitPlanes);
+	return cachedSequence(planes, seqId);
+}
+
+/**
+* @brief Allocates a sequence for all frames of memory-mapped image files and loads them.
+*
+* @param files Gray8 frames with the DMD dimensions, or with the rows of the area of interest.
+* @param[out] seqId The identifier of the new sequence.
+*
+* Gray sequences are loaded with one AlpSeqPut per chunk, directly from the mapped pages: the
+* files are read exactly once, by the transfer, and never copied. For 1-bit sequences, up to
+* `packFrames` frames at a time are thresholded and packed first. The sequence is not cached,
+* since recognizing it would mean hashing the whole library.
+*
+* A sequence file (AlpImageFiles::openSequence) replaces the bit planes, timing parameters and
+* area of interest by its own. Its frames are already in the uploaded format, so loading it
+* takes just the transfer.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::fileSequence(AlpImageFiles& files, ALP_ID& seqId) {
+	long const packFrames = 64;
+	if (initializeProjector() != 0)
+		return 1;
+	if (files.getBitPlanes() != 0) {
+		std::vector<unsigned long> const timing = files.getTimingParams();
+		bool const fullDmd = files.getFirstRow() == 0 && files.getHeight() == _height;
+		setSequenceParams(files.getBitPlanes(), _pictureOffset);
+		setTimingParams(timing[0], timing[1], timing[2], timing[3], timing[4]);
+		setAreaOfInterest(files.getFirstRow(), fullDmd ? 0 : files.getHeight());
+	}
+	try {
+		if (files.getFrameCount() == 0)
+			throw std::invalid_argument("Error: No image files opened.");
+		if (files.getWidth() != _width || files.getHeight() != activeRows())
+			throw std::invalid_argument("Error: Image and DMD dimensions differ.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	VERIFY_ALP_RESULT(_memory.alloc(_bitPlanes, files.getFrameCount(), &seqId));
+	if (_bitPlanes == 1)
+		VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_DATA_FORMAT, ALP_DATA_BINARY_TOPDOWN));
+	if (selectBitNum(seqId) != 0 || selectRows(seqId, _aoiFirstRow, files.getHeight()) != 0)
+		return 1;
+	VERIFY_ALP_NO_ECHO(AlpSeqTiming(AlpDevId, seqId, _illuminateTime, _pictureTime, _synchDelay, _synchPulseWidth, _triggerInDelay));
+
+	long picOffset = 0;
+	for (size_t i = 0; i < files.chunkCount(); i++) {
+		AlpFrames& chunk = files.chunk(i);
+		if (_bitPlanes > 1 || chunk._format == AlpFrames::PixelFormat::Binary) {
+			AlpProfilerBytes(chunk._frameCount * chunk.frameBytes());
+			VERIFY_ALP_NO_ECHO(AlpSeqPut(AlpDevId, seqId, picOffset, chunk._frameCount, chunk(0)));
+			picOffset += chunk._frameCount;
+			continue;
+		}
+		for (long frame = 0; frame < chunk._frameCount; frame += packFrames) {
+			long const count = std::min(packFrames, chunk._frameCount - frame);
+			AlpFrames gray(chunk(frame), count, chunk._width, chunk._height);
+			AlpFrames packed(count, chunk._width, chunk._height, AlpFrames::PixelFormat::Binary);
+			packed.packFrom(gray);
+			AlpProfilerBytes(count * packed.frameBytes());
+			VERIFY_ALP_NO_ECHO(AlpSeqPut(AlpDevId, seqId, picOffset, count, packed(0)));
+			picOffset += count;
+		}
+	}
+	return 0;
+}
+
+int Projector::cacheLookup(CachedSequence& cached, ALP_ID& seqId) {
+	std::vector<unsigned long> const timing = getTimingParams();
+	if (cached.timing != timing || cached.bitNum != _bitNum) {
+		if (selectBitNum(cached.sequenceId) != 0)
+			return 1;
+		VERIFY_ALP_NO_ECHO(AlpSeqTiming(AlpDevId, cached.sequenceId, _illuminateTime, _pictureTime, _synchDelay, _synchPulseWidth, _triggerInDelay));
+		cached.timing = timing;
+		cached.bitNum = _bitNum;
+	}
+	_cacheHits++;
+	_memory.touch(cached.sequenceId);
+	seqId = cached.sequenceId;
+	return 0;
+}
+
+/**
+* @brief Projects a resident sequence continuously, replacing the running one.
+*
+* @note AlpProjStartCont: the running sequence is replaced at the end of its current iteration.
+* @note The projected sequence is pinned in the sequence memory until the next switch, and
+* becomes the most recently used one.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::switchSequence(const ALP_ID seqId) {
+	VERIFY_ALP_NO_ECHO(AlpProjStartCont(AlpDevId, seqId));
+	_memory.pin(_projectedSeqId, false);
+	_memory.pin(seqId, true);
+	_memory.touch(seqId);
+	AlpSeqId = _projectedSeqId = seqId;
+	return 0;
+}
+
+/**
+* @brief Applies one command of the display loop (see display).
+*
+* A stop halts the projection before it is reported done, so the recorded reaction time is the
+* time until the DMD actually stops.
+*
+* @param LEDBrightness The brightness currently set, updated by a brightness command.
+* @param[out] stop Set by a stop command.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::applyCommand(tAlpCommand const& command, long& LEDBrightness, bool& stop) {
+	switch (command.Type) {
+	case AlpCommand::Stop:
+		stop = true;
+		return haltProjection();
+	case AlpCommand::Sequence:
+		return switchSequence(command.Value);
+	case AlpCommand::Brightness:
+		setBrightness(command.Value);
+		if (_thermal.enabled())
+			_thermal.setMaxBrightness(command.Value);
+		else {
+			VERIFY_ALP_NO_ECHO(AlpLedControl(AlpDevId, AlpLedId, ALP_LED_BRIGHTNESS, command.Value));
+			LEDBrightness = command.Value;
+		}
+		break;
+	}
+	return 0;
+}
+
+/**
+* @brief Stops the projection and releases the pin of the projected sequence.
+*
+* @note AlpProjHalt: the projection stops at once, not at the end of the sequence.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::haltProjection() {
+	VERIFY_ALP_NO_ECHO(AlpProjHalt(AlpDevId));
+	_memory.pin(_projectedSeqId, false);
+	_projectedSeqId = ALP_INVALID_ID;
+	return 0;
+}
+
+/**
+* @brief Builds a cache key from a pattern name and its drawing parameters.
+*
+* The frame count, bit planes, DMD dimensions and area of interest are included as well,
+* since they determine the rendered frames too.
+*/
+unsigned long long Projector::patternKey(const char* pattern, std::initializer_list<long> params) const {
+	// FNV-1a
+	unsigned long long key = 0xCBF29CE484222325ULL;
+	auto const add = [&key](unsigned long long value) {
+		for (int i = 0; i < 8; i++, value >>= 8)
+			key = (key ^ (value & 0xFF)) * 0x100000001B3ULL;
+	};
+	for (const char* c = pattern; *c != '\0'; c++)
+		add((unsigned char)*c);
+	for (long value : { _frames, _bitPlanes, _width, _height, _aoiFirstRow, activeRows() })
+		add((unsigned long long)value);
+	for (long value : params)
+		add((unsigned long long)value);
+	return key;
+}
+
+/**
+* @brief Allocates a sequence for the frames in `image`, loads them and applies the timing parameters.
+*
+* @param image The frames to upload. Binary frames are uploaded packed (ALP_DATA_BINARY_TOPDOWN)
+* into a 1-bit sequence, which transfers 8x less data than one byte per pixel. Gray8 frames for a 1-bit sequence
+* are thresholded and packed first (see AlpFrames::packFrom). Frames with fewer rows than the
+* DMD are loaded as an area of interest starting at their `_firstRow`.
+* @param[out] seqId The identifier of the new sequence.
+*
+* @note AlpSeqControl(ALP_DATA_FORMAT): selects how AlpSeqPut interprets the user data.
+*
+* @return int, 0 if the sequence was uploaded successfully, otherwise 1.
+*/
+int Projector::uploadSequence(AlpFrames& image, ALP_ID& seqId) {
+	if (_bitPlanes == 1 && image._format == AlpFrames::PixelFormat::Gray8) {
+		AlpFrames packed(image._frameCount, image._width, image._height, AlpFrames::PixelFormat::Binary, image._firstRow);
+		packed.packFrom(image);
+		return uploadSequence(packed, seqId);
+	}
+
+	// packed frames always form a 1-bit sequence
+	VERIFY_ALP_RESULT(_memory.alloc(image._format == AlpFrames::PixelFormat::Binary ? 1 : _bitPlanes, image._frameCount, &seqId));
+	if (image._format == AlpFrames::PixelFormat::Binary)
+		VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_DATA_FORMAT, ALP_DATA_BINARY_TOPDOWN));
+	if (selectBitNum(seqId) != 0 || selectRows(seqId, image._firstRow, image._height) != 0)
+		return 1;
+	AlpProfilerBytes(image._frameCount * image.frameBytes());
+	VERIFY_ALP_NO_ECHO(AlpSeqPut(AlpDevId, seqId, _pictureOffset, image._frameCount, image(0)));
+	VERIFY_ALP_NO_ECHO(AlpSeqTiming(AlpDevId, seqId, _illuminateTime, _pictureTime, _synchDelay, _synchPulseWidth, _triggerInDelay));
+	return 0;
+}
+
+/**
+* @brief Restricts a sequence to the DMD rows [firstRow, firstRow + rows) (area of interest).
+*
+* Only these rows are uploaded and loaded onto the DMD for each picture, so frames are smaller
+* and the ALP accepts picture times down to a fraction of the full-frame minimum. The other rows
+* are not addressed. Must precede AlpSeqPut and AlpSeqTiming of the sequence.
+*
+* @note AlpSeqControl(ALP_SEQ_DMD_LINES): MAKELONG(StartRow, RowCount).
+* @note AlpSeqInquire(ALP_MIN_PICTURE_TIME): the shortest picture time for the selected rows.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::selectRows(const ALP_ID seqId, const long firstRow, const long rows) {
+	try {
+		if (firstRow < 0 || rows <= 0 || firstRow + rows > _height)
+			throw std::invalid_argument("Error: Area of interest exceeds the DMD.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	if (firstRow != 0 || rows != _height)
+		VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_SEQ_DMD_LINES, MAKELONG(firstRow, rows)));
+	VERIFY_ALP_NO_ECHO(AlpSeqInquire(AlpDevId, seqId, ALP_MIN_PICTURE_TIME, &_minPictureTime));
+	if (firstRow != 0 || rows != _height)
+		_tprintf(_T("Area of interest: rows %i to %i, minimum picture time %i us\r\n"), firstRow, firstRow + rows - 1, _minPictureTime);
+	return 0;
+}
+
+// Rows of the frames of new sequences, see setAreaOfInterest
+long Projector::activeRows() const {
+	return _aoiRows > 0 ? _aoiRows : _height;
+}
+
+/**
+* @brief Applies `_bitNum` to a sequence: the ALP displays only its most significant bit planes.
+*
+* Fewer displayed planes need less illumination time per picture, so the minimum picture time
+* drops (roughly in half per plane removed), while the uploaded data stays untouched. 1-bit
+* sequences are not affected. Must precede AlpSeqTiming if the picture time is to be shortened.
+*
+* @note AlpSeqControl(ALP_BITNUM): 1 to ALP_BITPLANES planes, starting from the most significant one.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::selectBitNum(const ALP_ID seqId) {
+	long bitPlanes = 1;
+	VERIFY_ALP_NO_ECHO(AlpSeqInquire(AlpDevId, seqId, ALP_BITPLANES, &bitPlanes));
+	if (bitPlanes > 1)
+		VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, seqId, ALP_BITNUM, _bitNum > 0 ? std::min(_bitNum, bitPlanes) : bitPlanes));
+	return 0;
+}
+
+/**
+* @brief Prepares gapless projection of an unbounded series of sequences (streaming).
+*
+* @param sequenceFrames The number of frames per streamed sequence, i.e. the largest AlpFrames
+* accepted by streamPattern.
+* @param slots The number of sequences kept in rotation. Two suffice if uploading a sequence
+* takes less time than displaying one; more slots absorb jitter in rendering and uploading.
+*
+* The sequence queue (ALP_PROJ_QUEUE_MODE = ALP_PROJ_SEQUENCE_QUEUE) lets AlpProjStart
+* enqueue a sequence behind the running one instead of replacing it, and the ALP switches
+* to the next sequence without a gap. `slots` sequences are allocated once, each streamPattern
+* call fills one that is not queued and enqueues it, while the others are being displayed.
+*
+* The LED is initialized as for generatePattern. Timing is taken from the image data and
+* timing parameters.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::startStreaming(const long sequenceFrames, const long slots) {
+	if (initializeProjector() != 0)
+		return 1;
+
+	long queueLength = 0;
+	VERIFY_ALP_NO_ECHO(AlpProjInquire(AlpDevId, ALP_PROJ_QUEUE_MAX_AVAIL, &queueLength));
+	try {
+		if (!_streamSlots.empty())
+			throw std::invalid_argument("Error: Streaming has already been started.");
+		if (sequenceFrames < 1)
+			throw std::invalid_argument("Error: A streamed sequence needs at least one frame.");
+		// one sequence is being displayed, the others wait in the queue
+		if (slots < 2 || slots > queueLength + 1)
+			throw std::invalid_argument("Error: Number of stream slots must be at least 2 and fit into the sequence queue.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	VERIFY_ALP_NO_ECHO(AlpProjControl(AlpDevId, ALP_PROJ_QUEUE_MODE, ALP_PROJ_SEQUENCE_QUEUE));
+	_streamFrames = sequenceFrames;
+	for (long i = 0; i < slots; i++) {
+		StreamSlot slot = { ALP_INVALID_ID, ALP_INVALID_ID, false };
+		VERIFY_ALP_RESULT(_memory.alloc(_bitPlanes, sequenceFrames, &slot.sequenceId));
+		_memory.pin(slot.sequenceId, true);
+		_streamSlots.push_back(slot);
+		if (_bitPlanes == 1)
+			VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, slot.sequenceId, ALP_DATA_FORMAT, ALP_DATA_BINARY_TOPDOWN));
+		if (selectBitNum(slot.sequenceId) != 0 || selectRows(slot.sequenceId, _aoiFirstRow, activeRows()) != 0)
+			return 1;
+		VERIFY_ALP_NO_ECHO(AlpSeqTiming(AlpDevId, slot.sequenceId, _illuminateTime, _pictureTime, _synchDelay, _synchPulseWidth, _triggerInDelay));
+	}
+
+	return initializeLED();
+}
+
+/**
+* @brief Uploads `image` into a free stream slot and enqueues it behind the sequences already streamed.
+*
+* @param image Up to `sequenceFrames` frames (see startStreaming), covering the area of interest
+* set before startStreaming. Gray8 frames for a 1-bit sequence are thresholded and packed first.
+*
+* Blocks while all slots are queued, until the sequence in the oldest slot has been displayed.
+* The caller keeps the projection gapless by calling streamPattern again before the queue
+* runs empty, i.e. within (slots - 1) sequence durations.
+*
+* @note AlpProjStart: in sequence queue mode, appends the sequence to the queue and returns immediately.
+* @note AlpProjInquire(ALP_PROJ_QUEUE_ID): the QueueID of the most recently enqueued sequence.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::streamPattern(AlpFrames& image) {
+	try {
+		if (_streamSlots.empty())
+			throw std::invalid_argument("Error: Call startStreaming before streamPattern.");
+		if (image._frameCount > _streamFrames || image._width != _width || image._height != activeRows() || image._firstRow != _aoiFirstRow)
+			throw std::invalid_argument("Error: Streamed frames do not fit the stream sequences.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+
+	if (_bitPlanes == 1 && image._format == AlpFrames::PixelFormat::Gray8) {
+		AlpFrames packed(image._frameCount, image._width, image._height, AlpFrames::PixelFormat::Binary, image._firstRow);
+		packed.packFrom(image);
+		return streamPattern(packed);
+	}
+
+	StreamSlot* slot = nullptr;
+	while (slot == nullptr) {
+		unsigned long waitTime = 0;
+		if (updateStreamSlots(waitTime) != 0)
+			return 1;
+		for (auto& candidate : _streamSlots)
+			if (!candidate.queued) {
+				slot = &candidate;
+				break;
+			}
+		if (slot == nullptr)
+			std::this_thread::sleep_for(std::chrono::microseconds(waitTime));
+	}
+
+	VERIFY_ALP_NO_ECHO(AlpSeqControl(AlpDevId, slot->sequenceId, ALP_LASTFRAME, image._frameCount - 1));
+	AlpProfilerBytes(image._frameCount * image.frameBytes());
+	VERIFY_ALP_NO_ECHO(AlpSeqPut(AlpDevId, slot->sequenceId, 0, image._frameCount, image(0)));
+	VERIFY_ALP_NO_ECHO(AlpProjStart(AlpDevId, slot->sequenceId));
+	long queueId = 0;
+	VERIFY_ALP_NO_ECHO(AlpProjInquire(AlpDevId, ALP_PROJ_QUEUE_ID, &queueId));
+	slot->queueId = (ALP_ID)queueId;
+	slot->queued = true;
+	return 0;
+}
+
+/**
+* @brief Ends streaming and frees the stream sequences.
+*
+* @param drain If true, waits until every enqueued sequence has been displayed, otherwise the
+* projection is halted immediately.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::stopStreaming(const bool drain) {
+	for (bool pending = drain; pending; ) {
+		unsigned long waitTime = 0;
+		if (updateStreamSlots(waitTime) != 0)
+			return 1;
+		pending = std::any_of(_streamSlots.begin(), _streamSlots.end(), [](StreamSlot const& s) { return s.queued; });
+		if (pending)
+			std::this_thread::sleep_for(std::chrono::microseconds(waitTime));
+	}
+
+	VERIFY_ALP_NO_ECHO(AlpProjHalt(AlpDevId));
+	for (auto const& slot : _streamSlots)
+		VERIFY_ALP_RESULT(_memory.free(slot.sequenceId));
+	_streamSlots.clear();
+	VERIFY_ALP_NO_ECHO(AlpProjControl(AlpDevId, ALP_PROJ_QUEUE_MODE, ALP_PROJ_LEGACY));
+	return 0;
+}
+
+/**
+* @brief Streams raw frames read from a pipe (stdin or a FIFO) until its end, in sequences of `sequenceFrames` frames.
+*
+* @param input Opened in binary mode. Frames follow each other without headers, each holding
+* the rows of the area of interest (the whole DMD by default) at the DMD width.
+* @param format Gray8: one byte per pixel, thresholded for 1-bit sequences. Binary: packed as
+* ALP_DATA_BINARY_TOPDOWN (AlpFrames::binaryRowBytes per row), 1-bit sequences only.
+* @param sequenceFrames, slots As for startStreaming.
+*
+* A batch is only read once a stream slot is free, so while the sequence queue is full the
+* pipe fills up and the writing process blocks: it is throttled to the display rate (backpressure)
+* without frames being dropped or buffered without bound. The last batch may be shorter, an
+* incomplete frame at the end of the input is discarded. Prints the sustained frame rate, from
+* the first frame read until the last one has been displayed.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::streamInput(std::FILE* input, const AlpFrames::PixelFormat format, const long sequenceFrames, const long slots) {
+	if (initializeProjector() != 0)
+		return 1;
+	try {
+		if (format == AlpFrames::PixelFormat::Binary && _bitPlanes != 1)
+			throw std::invalid_argument("Error: Packed binary input needs a 1-bit sequence.");
+	}
+	catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		Pause();
+		exit(1);
+	}
+	if (startStreaming(sequenceFrames, slots) != 0)
+		return 1;
+
+	AlpFrames batch(sequenceFrames, _width, activeRows(), format, _aoiFirstRow);
+	unsigned long long frames = 0, sequences = 0;
+	double inputWait = 0;
+	auto const start = std::chrono::steady_clock::now();
+	for (bool atEnd = false; !atEnd; ) {
+		auto const readStart = std::chrono::steady_clock::now();
+		long count = 0;
+		while (count < sequenceFrames && std::fread(batch(count), batch.frameBytes(), 1, input) == 1)
+			count++;
+		inputWait += std::chrono::duration<double>(std::chrono::steady_clock::now() - readStart).count();
+		atEnd = count < sequenceFrames;
+		if (count == 0)
+			break;
+
+		AlpFrames frameView(batch(0), count, batch._width, batch._height, format, batch._firstRow);
+		if (streamPattern(frameView) != 0)
+			return 1;
+		frames += count, sequences++;
+	}
+	if (stopStreaming() != 0)
+		return 1;
+
+	double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	_tprintf(_T("Streamed %llu frames in %llu sequences: %.1f fps sustained, %.1f MB/s, %.1f s waiting for input\r\n"),
+		frames, sequences, frames / seconds, frames * batch.frameBytes() / seconds / 1e6, inputWait);
+	return 0;
+}
+
+/**
+* @brief Marks stream slots whose sequence has been displayed as free.
+*
+* QueueIDs are assigned in ascending order, so every slot enqueued before the running
+* sequence has finished, and all of them have once the queue is idle.
+*
+* @param[out] waitTime Time until the running sequence ends [us], i.e. until the next slot
+* can become free. Bounded to 100 us..`_sleepTime` ms.
+*
+* @note AlpProjInquireEx(ALP_PROJ_PROGRESS): reports the running sequence, its remaining frames and picture time.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::updateStreamSlots(unsigned long& waitTime) {
+	tAlpProjProgress progress;
+	VERIFY_ALP_NO_ECHO(AlpProjInquireEx(AlpDevId, ALP_PROJ_PROGRESS, &progress));
+	bool const idle = (progress.nFlags & ALP_FLAG_QUEUE_IDLE) != 0;
+	for (auto& slot : _streamSlots)
+		if (slot.queued && (idle || slot.queueId < progress.CurrentQueueId))
+			slot.queued = false;
+
+	unsigned long long const remaining = (unsigned long long)progress.nFrameCounter * progress.nPictureTime;
+	waitTime = (unsigned long)std::clamp(remaining, 100ULL, _sleepTime * 1000ULL);
+	return 0;
+}
+
 long Projector::getBrightness() const {
 	return _brightness;
 }
 
+// The allocated device, e.g. for the trigger input of the emulator (AlpEmuTrigger)
+ALP_ID Projector::getDeviceId() const {
+	return AlpDevId;
+}
+
+long Projector::getWidth() const {
+	return _width;
+}
+
+long Projector::getHeight() const {
+	return _height;
+}
+
 std::vector<unsigned long> Projector::getImageDataParams() const {
 	return std::vector<unsigned long>{(unsigned long)_frames, (unsigned long)_spacing, _pictureTime, (unsigned long)_brightness};
 }
 
 std::vector<unsigned long> Projector::getSequenceParams() const {
-	return std::vector<unsigned long>{ unsigned long(_bitPlanes), unsigned long(_pictureOffset)};
+	return std::vector<unsigned long>{(unsigned long)_bitPlanes, (unsigned long)_pictureOffset};
 }
 
 std::vector<unsigned long> Projector::getTimingParams() const {
 	return std::vector<unsigned long> {_illuminateTime, _pictureTime, _synchDelay, _synchPulseWidth, _triggerInDelay};
 }
 
+/**
+* @brief The latest LED telemetry sample, without blocking.
+*
+* @return bool, false if telemetry is off or no sample has been taken yet.
+*/
+bool Projector::getLEDTelemetry(tAlpLedSample& sample) const {
+	return _telemetry.latest(sample);
+}
+
+// Telemetry samples taken, samples dropped because the log fell behind
+std::vector<unsigned long> Projector::getTelemetryStats() const {
+	return std::vector<unsigned long> {(unsigned long)_telemetry.sampleCount(), (unsigned long)_telemetry.droppedCount()};
+}
+
+// Of the last display: time derated [ms], time under thermal control [ms], lowest brightness [%]
+std::vector<unsigned long> Projector::getThermalStats() const {
+	return std::vector<unsigned long> {(unsigned long)(_thermal.deratedTime() * 1000), (unsigned long)(_thermal.controlledTime() * 1000),
+		(unsigned long)_thermal.minBrightness()};
+}
+
+// Commands applied by display, their mean and maximum time from request to completion [us]
+std::vector<unsigned long> Projector::getControlStats() const {
+	tAlpCommandStats const stats = _commands.stats();
+	return std::vector<unsigned long> {(unsigned long)stats.Commands, (unsigned long)stats.Mean, (unsigned long)stats.Max};
+}
+
+// Of the last projectTriggered: frames completed, time from the start until the end of the projection [us], missed triggers
+std::vector<unsigned long> Projector::getTriggeredStats() const {
+	return std::vector<unsigned long> {_triggeredFrames, _triggeredTime, _missedTriggers};
+}
+
+// Resident sequences, cache hits, cache misses
+std::vector<unsigned long> Projector::getCacheStats() const {
+	return std::vector<unsigned long> {(unsigned long)_sequenceCache.size(), _cacheHits, _cacheMisses};
+}
+
+// updateSequence calls that found a resident sequence, frames they loaded, unchanged frames they left in place
+std::vector<unsigned long> Projector::getUpdateStats() const {
+	return std::vector<unsigned long> {_updates, _updatedFrames, _skippedFrames};
+}
+
+// ALP_MIN_PICTURE_TIME of the last sequence allocated [us], lower for smaller areas of interest
+unsigned long Projector::getMinPictureTime() const {
+	return (unsigned long)_minPictureTime;
+}
+
+/**
+* @brief Occupancy of the on-board sequence memory, see AlpSequenceMemory.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::getMemoryStats(tAlpSeqMemoryStats& stats) const {
+	VERIFY_ALP_RESULT(_memory.getStats(stats));
+	return 0;
+}
+
 void Projector::setBrightness(long brightness) {
 	_brightness = brightness;
 }
@@ -135,11 +1175,126 @@ void Projector::setSequenceParams(const long bitPlanes, const long pictureOffset
 	_bitPlanes = bitPlanes; _pictureOffset = pictureOffset;
 }
 
+/**
+* @brief Restricts the following sequences to a horizontal band of the DMD (area of interest).
+*
+* @param firstRow The first DMD row of the band.
+* @param rows The number of rows, 0 for the whole DMD.
+*
+* Frames then hold only these rows: render callbacks get frames of `rows` rows whose row 0 is
+* DMD row `firstRow`, and streamed frames must have this size. Memory and upload shrink in
+* proportion to the band height, and shorter picture times become possible (see getMinPictureTime).
+*/
+void Projector::setAreaOfInterest(const long firstRow, const long rows) {
+	_aoiFirstRow = firstRow; _aoiRows = rows;
+}
+
+/**
+* @brief Selects how many bit planes of gray sequences are displayed (ALP_BITNUM), trading gray levels for frame rate.
+*
+* @param bitNum Planes to display, starting from the most significant one; 0 for all. Sequences
+* with fewer planes display all of theirs.
+*
+* Applies to new and cached sequences, and right away to the projected sequence, which is
+* restarted with the current timing parameters. Nothing is rendered or uploaded again; set a
+* shorter picture time with setTimingParams first to actually gain frame rate.
+*
+* @return int, 0 on success, otherwise 1.
+*/
+int Projector::setBitNum(const long bitNum) {
+	_bitNum = bitNum;
+	if (_projectedSeqId == ALP_INVALID_ID)
+		return 0;
+
+	if (selectBitNum(_projectedSeqId) != 0)
+		return 1;
+	VERIFY_ALP_NO_ECHO(AlpSeqTiming(AlpDevId, _projectedSeqId, _illuminateTime, _pictureTime, _synchDelay, _synchPulseWidth, _triggerInDelay));
+	VERIFY_ALP_NO_ECHO(AlpSeqInquire(AlpDevId, _projectedSeqId, ALP_MIN_PICTURE_TIME, &_minPictureTime));
+	for (auto& entry : _sequenceCache)
+		if (entry.second.sequenceId == _projectedSeqId)
+			entry.second = CachedSequence{ _projectedSeqId, getTimingParams(), _bitNum };
+	return switchSequence(_projectedSeqId);
+}
+
 void Projector::setTimingParams(const unsigned long illuminateTime, const unsigned long pictureTime, const unsigned long synchDelay, const unsigned long synchPulseWidth, const unsigned long triggerInDelay) {
-	_illuminateTime = illuminateTime; _pictureOffset = pictureTime; _synchDelay = synchDelay;
+	_illuminateTime = illuminateTime; _pictureTime = pictureTime; _synchDelay = synchDelay;
 	_synchPulseWidth = synchPulseWidth; _triggerInDelay = triggerInDelay;
 }
 
+void Projector::setLEDType(long LEDType) {
+	_LEDType = LEDType;
+}
+
+/**
+* @brief Keeps the LED junction below `ceiling` during display by reducing the brightness, see AlpThermalController.
+*
+* @param ceiling Junction temperature [degC]; 0 disables the controller. Should stay below the
+* hard limit of checkLEDExceedsLimits (100 degC), which still stops the projection.
+* @param kp, ki Gains of the PI controller [% per degC], [% per degC and second]. The defaults
+* suit a thermal time constant of about 4 s and 0.6 degC per % brightness: on the emulated LED,
+* the junction overshoots a 60 degC ceiling by about 3 degC before it settles.
+*
+* The brightness set with setBrightness (or at the prompt) is the maximum; it is only reduced
+* as far as needed to hold the ceiling.
+*/
+void Projector::setThermalLimit(const double ceiling, const double kp, const double ki) {
+	_thermal.configure(ceiling, kp, ki);
+}
+
+/**
+* @brief Samples the LED current and junction temperature on a background thread, see AlpLedTelemetry.
+*
+* @param rate Samples per second, 1 to 1000; 0 for no telemetry.
+* @param logPath File the samples are appended to, CSV if it ends in ".csv", otherwise binary
+* tAlpLedSample records. Empty for no log.
+*
+* Sampling starts once the LED is allocated (initializeLED) and runs until the Projector is
+* destroyed. display then reads the latest sample instead of inquiring the LED itself.
+*/
+void Projector::setTelemetry(const unsigned long rate, const std::filesystem::path& logPath) {
+	_telemetryRate = rate; _telemetryLog = logPath;
+}
+
+/**
+* @brief Selects between console prompts and unattended (headless) operation.
+*
+* @param interactive If true, initializeLED prompts for LED type and brightness and display
+* runs until a key is hit. If false, the values from setLEDType and setBrightness are used
+* and display stops by itself.
+* @param runTime Projection time in milliseconds when not interactive.
+*/
+void Projector::setInteractive(bool interactive, unsigned long runTime) {
+	_interactive = interactive; _runTime = runTime;
+}
+
+/**
+* @brief Ends a running display, from any thread.
+*
+* display wakes up at once and halts the projection; the time until it has is recorded in
+* getControlStats. A request made while no display runs ends the next one right away.
+*/
+void Projector::requestStop() {
+	_commands.post(AlpCommand::Stop);
+}
+
+/**
+* @brief Makes a running display project another sequence, from any thread.
+*
+* @param seqId A sequence allocated and uploaded before, e.g. by cachedSequence.
+*/
+void Projector::requestSequence(const ALP_ID seqId) {
+	_commands.post(AlpCommand::Sequence, seqId);
+}
+
+/**
+* @brief Changes the LED brightness of a running display, from any thread.
+*
+* With a thermal limit, the brightness becomes the new maximum of the controller.
+*/
+void Projector::requestBrightness(const long brightness) {
+	_commands.post(AlpCommand::Brightness, brightness);
+}
+
 void Projector::printParameters(std::vector<unsigned long> const& params) const {
 	for (auto i : params) {
 		_tprintf(_T("%i "), i);
@@ -189,22 +1344,33 @@ bool Projector::checkLEDExceedsLimits() const {
 * @return int 0 on success, 1 on failure
 */
 int Projector::initializeLED() {
-	_tprintf(_T("\r\nPlease enter the correct type of the connected LED\r\n"));
-	_LEDType = AlpLedTypePrompt();
+	// the LED driver is allocated once, later calls only update the brightness
+	if (!_LEDAllocated) {
+		if (_interactive) {
+			_tprintf(_T("\r\nPlease enter the correct type of the connected LED\r\n"));
+			_LEDType = AlpLedTypePrompt();
+		}
+
+		VERIFY_ALP_NO_ECHO(AlpLedAlloc(AlpDevId, _LEDType, NULL, &AlpLedId));
+		_LEDAllocated = true;
 
-	VERIFY_ALP_NO_ECHO(AlpLedAlloc(AlpDevId, _LEDType, NULL, &AlpLedId));
+		VERIFY_ALP_NO_ECHO(AlpLedInquire(AlpDevId, AlpLedId, ALP_LED_SET_CURRENT, &_LEDContCurrent));
+		_tprintf(_T("This LED can be driven with continuous current of %0.1f A\r\n"), (double)_LEDContCurrent / 1000.);
 
-	VERIFY_ALP_NO_ECHO(AlpLedInquire(AlpDevId, AlpLedId, ALP_LED_SET_CURRENT, &_LEDContCurrent));
-	_tprintf(_T("This LED can be driven with continuous current of %0.1f A\r\n"), (double)_LEDContCurrent / 1000.);
+		VERIFY_ALP_NO_ECHO(AlpLedInquireEx(AlpDevId, AlpLedId, ALP_LED_ALLOC_PARAMS, &_LEDParams));
+		_tprintf(_T("The LED driver has I2C bus addresses DAC=%i, ADC=%i\r\n"), _LEDParams.I2cDacAddr, _LEDParams.I2cAdcAddr);
 
-	VERIFY_ALP_NO_ECHO(AlpLedInquireEx(AlpDevId, AlpLedId, ALP_LED_ALLOC_PARAMS, &_LEDParams));
-	_tprintf(_T("The LED driver has I2C bus addresses DAC=%i, ADC=%i\r\n"), _LEDParams.I2cDacAddr, _LEDParams.I2cAdcAddr);
+		if (_telemetryRate > 0 && _telemetry.start(AlpDevId, AlpLedId, _telemetryRate, _telemetryLog) != 0)
+			return 1;
+	}
 
 	// User enters percentage for LED brightness:
 	// Note: this application limits input values to 100 percent,
 	//	whilst the API allows overdriving the LED
-	_tprintf(_T("\r\nEnter requested brightness. "));
-	setBrightness((AlpPercentPrompt(_T("Percent (0..100): "))));
+	if (_interactive) {
+		_tprintf(_T("\r\nEnter requested brightness. "));
+		setBrightness((AlpPercentPrompt(_T("Percent (0..100): "))));
+	}
 	_tprintf(_T("Note: Expected current at %i%% is %0.1f A\r\n"), getBrightness(),
 		(double)getBrightness() / 100 * (double)_LEDContCurrent / 1000);
 
@@ -215,6 +1381,22 @@ int Projector::initializeLED() {
 	return 0;
 }
 
+/**
+* @brief Requests a stop as soon as a key is hit, polling the console every millisecond on a thread of its own.
+*
+* The thread ends with the returned std::jthread, i.e. when it is reset or destroyed.
+*/
+std::jthread Projector::watchKeyboard() {
+	_tprintf(_T("\r\nPress any key to stop projection.\r\n"));
+	return std::jthread([this](std::stop_token stop) {
+		for (; !stop.stop_requested(); Sleep(1))
+			if (_kbhit() != 0) {
+				requestStop();
+				return;
+			}
+	});
+}
+
 /**
 * @brief Continuous projection of a pre-defined sequence of images, with monitoring of LED current and temperature
 *
@@ -223,12 +1405,21 @@ int Projector::initializeLED() {
 * and temperature using the `AlpLedInquire` function and  runs until a key has been hit or until the temperature
 * exceeds a certain limit (by default 100*256). In case of this happening, the LED is switched off and the program stops.
 *
+* The loop sleeps on a command queue (AlpCommandQueue) until its next monitoring tick, measured
+* with the steady clock. Requests from other threads (requestStop, requestSequence,
+* requestBrightness) wake it at once, so they take effect within about a millisecond instead of
+* a monitoring period. With telemetry, the tick also follows the sample rate, so the
+* temperature limit is checked as often as samples arrive. A sample is only used while the
+* sampler has not failed and it is at most three sampling periods old; otherwise the current
+* and temperature are inquired directly, so the limit never acts on a frozen temperature.
+*
 * @note The LED current is measured in milliamperes (mA) and the temperature is measured in 1C/256.
 *
 * @note AlpProjStartCont (ALP_ID DeviceId, ALP_ID SequenceId): This function displays the specified sequence in an infinite loop.
 * The sequence display can be stopped using AlpProjHalt or AlpDevHalt.
 *
 * @note _kbhit(): keyboard hit. Has value 0 until a key is pressed, after which it gains the value 1.
+* When interactive, a separate thread polls it every millisecond and requests a stop.
 *
 * @note AlpDevInquire: inquires the device of certain parameters i.e. current or temperature.
 *
@@ -237,26 +1428,99 @@ int Projector::initializeLED() {
 *
 * @note pause: pauses the execution until a key is pressed.
 *
+* @note When not interactive (see setInteractive), the projection runs for `_runTime` milliseconds instead.
+*
+* @note With a thermal limit (see setThermalLimit), the loop runs every 100 ms and adjusts
+* ALP_LED_BRIGHTNESS, and the time spent derated is reported at the end.
+*
+* @note The projection is halted (AlpProjHalt) when the loop ends, whether by a stop request,
+* the run time or the temperature limit, before the final Pause.
+*
 * @note When terminating the ALP system, use AlpDevFree before disconnecting it from the USB to
 * avoid problems after USB re-connection.
 */
 int Projector::display() {
-	VERIFY_ALP_NO_ECHO(AlpProjStartCont(AlpDevId, AlpSeqId));
+	if (switchSequence(AlpSeqId) != 0)
+		return 1;
 
-	_tprintf(_T("\r\nPress any key to stop projection.\r\n"));
-	while (_kbhit() == 0) {
-		Sleep(_sleepTime);
+	AlpTraceSpan span("project");
+	// thermal control needs a shorter period than the status display, telemetry samples are free to read
+	unsigned long period = _thermal.enabled() ? std::min(_sleepTime, 100UL) : _sleepTime;
+	if (_telemetry.running())
+		period = std::min(period, std::max(1000UL / _telemetryRate, 1UL));
+	long LEDBrightness = getBrightness();
+	_thermal.reset(LEDBrightness);
+
+	// the console is only watched when interactive, and no longer once the loop has ended
+	std::jthread keyWatcher = _interactive ? watchKeyboard() : std::jthread();
+
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point const start = Clock::now(), end = start + std::chrono::milliseconds(_runTime);
+	Clock::time_point lastTick = start, lastStatus = start - std::chrono::seconds(1);
+	Clock::time_point nextTick = start + std::chrono::milliseconds(period);
+	Clock::duration const maxSampleAge = std::chrono::milliseconds(3000 / std::max(_telemetryRate, 1UL));
+	bool telemetryFailed = false;
+	for (bool stop = false; !stop; ) {
+		Clock::time_point const deadline = _interactive ? nextTick : std::min(nextTick, end);
+		tAlpCommand command;
+		if (_commands.wait(command, deadline)) {
+			// failed commands are recorded too, so every posted command shows up in the stats
+			int const result = applyCommand(command, LEDBrightness, stop);
+			_commands.done(command);
+			if (result != 0)
+				return 1;
+			continue;
+		}
+
+		Clock::time_point const now = Clock::now();
+		stop = !_interactive && now >= end;
+		double const dt = std::chrono::duration<double>(now - lastTick).count();
+		lastTick = now;
+		nextTick = std::max(nextTick + std::chrono::milliseconds(period), now);
+
+		// with telemetry, a recent sample replaces the inquiries; the sampler stops at its first failed inquiry
+		tAlpLedSample sample;
+		bool const sampling = _telemetry.running() && _telemetry.result() == ALP_OK;
+		if (_telemetry.running() && !sampling && !telemetryFailed) {
+			telemetryFailed = true;
+			_tprintf(_T("\r\nNote: LED telemetry stopped (error %ld), inquiring the LED directly.\r\n"), _telemetry.result());
+		}
+		if (sampling && _telemetry.latest(sample) && now - Clock::time_point(std::chrono::nanoseconds(sample.Time)) <= maxSampleAge)
+			_LEDCurrent = sample.Current, _LEDJunctionTemp = sample.JunctionTemp;
+		else {
+			VERIFY_ALP_NO_ECHO(AlpLedInquire(AlpDevId, AlpLedId, ALP_LED_MEASURED_CURRENT, &_LEDCurrent));
+			VERIFY_ALP_NO_ECHO(AlpLedInquire(AlpDevId, AlpLedId, ALP_LED_TEMPERATURE_JUNCTION, &_LEDJunctionTemp));
+		}
 
-		VERIFY_ALP_NO_ECHO(AlpLedInquire(AlpDevId, AlpLedId, ALP_LED_MEASURED_CURRENT, &_LEDCurrent));
-		VERIFY_ALP_NO_ECHO(AlpLedInquire(AlpDevId, AlpLedId, ALP_LED_TEMPERATURE_JUNCTION, &_LEDJunctionTemp));
+		if (_thermal.enabled()) {
+			long const output = _thermal.update((double)_LEDJunctionTemp / 256, dt);
+			if (output != LEDBrightness)
+				VERIFY_ALP_NO_ECHO(AlpLedControl(AlpDevId, AlpLedId, ALP_LED_BRIGHTNESS, output));
+			LEDBrightness = output;
+		}
 
-		_tprintf(_T("Note: LED current=%0.1f A; Junction Temperature=%0.1f \370C\r"),
-			(double)_LEDCurrent / 1000, (double)_LEDJunctionTemp / 256);
+		// at most ten status lines per second, however short the period
+		if (now - lastStatus >= std::chrono::milliseconds(100)) {
+			lastStatus = now;
+			if (_thermal.enabled())
+				_tprintf(_T("Note: LED current=%0.1f A; Junction Temperature=%0.1f \370C; Brightness=%ld%%\r"),
+					(double)_LEDCurrent / 1000, (double)_LEDJunctionTemp / 256, LEDBrightness);
+			else
+				_tprintf(_T("Note: LED current=%0.1f A; Junction Temperature=%0.1f \370C\r"),
+					(double)_LEDCurrent / 1000, (double)_LEDJunctionTemp / 256);
+		}
 
 		if (checkLEDExceedsLimits())
 			break;
 	}
+	keyWatcher = std::jthread();
+	if (_projectedSeqId != ALP_INVALID_ID && haltProjection() != 0)
+		return 1;
+	if (_thermal.enabled())
+		_tprintf(_T("\r\nThermal control: derated %0.1f of %0.1f s, brightness down to %ld%%"),
+			_thermal.deratedTime(), _thermal.controlledTime(), _thermal.minBrightness());
 	_tprintf(_T("\r\n\r\nFinished.\r\n"));
-	Pause();
+	if (_interactive)
+		Pause();
 	return 0;
 }
\ No newline at end of file
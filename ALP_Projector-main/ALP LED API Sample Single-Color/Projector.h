@@ -2,8 +2,24 @@
 #include "alp.h"
 #include "AlpUserInterface.h"
 #include "AlpFrames.h"
+#include "AlpUploader.h"
+#include "AlpSequenceMemory.h"
+#include "AlpImageFiles.h"
+#include "AlpLedTelemetry.h"
+#include "AlpThermalController.h"
+#include "AlpProfiler.h"
+#include "AlpCommandQueue.h"
+#ifdef _WIN32
 #include <conio.h>
 #include <crtdbg.h>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <initializer_list>
+#include <unordered_map>
+#include <thread>
 #include <vector>
 #include <iostream>
 #include <stdexcept>
@@ -11,10 +27,15 @@
 
 // Error handling policy: Quit, whenever an ALP error happens.
 // VERIFY_ALP also echoes each successfull ALP API call (in contrast to VERIFY_ALP_NO_ECHO)
+// Both time the call and record it in AlpProfiler.
 #define VERIFY_ALP( AlpApiCall ) \
-	if (AlpError(AlpApiCall, _T(#AlpApiCall), true)) { Pause(); return 1; }
+	if (AlpError(AlpProfileCall(_T(#AlpApiCall), [&] { return AlpApiCall; }), _T(#AlpApiCall), true)) { Pause(); return 1; }
 #define VERIFY_ALP_NO_ECHO( AlpApiCall ) \
-	if (AlpError(AlpApiCall, _T(#AlpApiCall), false)) { Pause(); return 1; }
+	if (AlpError(AlpProfileCall(_T(#AlpApiCall), [&] { return AlpApiCall; }), _T(#AlpApiCall), false)) { Pause(); return 1; }
+// VERIFY_ALP_RESULT checks the ALP result of a helper (AlpSequenceMemory, AlpUploader) without
+// recording it; the helper records the ALP calls it makes itself.
+#define VERIFY_ALP_RESULT( HelperCall ) \
+	if (AlpError(HelperCall, _T(#HelperCall), false)) { Pause(); return 1; }
 
 class Projector {
 public:
@@ -34,6 +55,15 @@ public:
 		_LEDContCurrent = 0;
 		_LEDCurrent = 0, _LEDJunctionTemp = 0, deviceNum = 0, initFlag = 0;
 		_sleepTime = 1000;
+		_interactive = true, _runTime = 0;
+		_deviceAllocated = false, _streamFrames = 0;
+		_LEDAllocated = false, _cacheHits = 0, _cacheMisses = 0;
+		_projectedSeqId = ALP_INVALID_ID;
+		_aoiFirstRow = 0, _aoiRows = 0, _minPictureTime = 0;
+		_bitNum = 0;
+		_telemetryRate = 0;
+		_triggeredFrames = 0, _triggeredTime = 0, _missedTriggers = 0;
+		_updates = 0, _updatedFrames = 0, _skippedFrames = 0;
 
 		try {
 			if (sizeof(_AlpSynchGate) != 18)
@@ -53,27 +83,105 @@ public:
 
 	virtual ~Projector();
 
+	int initializeProjector();
+
 	int generatePattern(const long frames = 1, const long spacing = 4, const unsigned long pictureTime = 200000, const long brightness = 100);
+	int scrollPattern(AlpFrames& strip, const long fromRow, const long toRow, const long lineInc);
+	int projectFrames(AlpFrames& image);
+	int projectFiles(AlpImageFiles& files);
+	int projectTriggered(AlpFrames& image, const long mode = ALP_PROJ_STEP, const long condition = ALP_EDGE_RISING,
+		std::function<void()> const& started = {}, std::function<unsigned long long()> const& triggerCount = {});
+
+	int startStreaming(const long sequenceFrames, const long slots = 3);
+	int streamPattern(AlpFrames& image);
+	int stopStreaming(const bool drain = true);
+	int streamInput(std::FILE* input, const AlpFrames::PixelFormat format, const long sequenceFrames, const long slots = 3);
 
+	int cachedSequence(const unsigned long long key, std::function<void(AlpFrames&, long)> const& render, ALP_ID& seqId);
+	int cachedSequence(AlpFrames& image, ALP_ID& seqId);
+	int updateSequence(AlpFrames& image, ALP_ID& seqId);
+	int planeSequence(AlpFrames& gray, const long bitPlanes, ALP_ID& seqId);
+	int fileSequence(AlpImageFiles& files, ALP_ID& seqId);
+	int switchSequence(const ALP_ID seqId);
+	unsigned long long patternKey(const char* pattern, std::initializer_list<long> params) const;
+
+	ALP_ID getDeviceId() const;
 	long getBrightness() const;
+	long getWidth() const;
+	long getHeight() const;
 	std::vector<unsigned long> getImageDataParams() const;
 	std::vector<unsigned long> getSequenceParams() const;
 	std::vector<unsigned long> getTimingParams() const;
+	std::vector<unsigned long> getCacheStats() const;
+	std::vector<unsigned long> getUpdateStats() const;
+	unsigned long getMinPictureTime() const;
+	int getMemoryStats(tAlpSeqMemoryStats& stats) const;
+	bool getLEDTelemetry(tAlpLedSample& sample) const;
+	std::vector<unsigned long> getTelemetryStats() const;
+	std::vector<unsigned long> getThermalStats() const;
+	std::vector<unsigned long> getControlStats() const;
+	std::vector<unsigned long> getTriggeredStats() const;
 	void printParameters(std::vector<unsigned long> const& params) const;
 
 	void setBrightness(long brightness);
 	void setImageDataParams(const long frames, const long spacing, const unsigned long pictureTime, const long brightness);
 	void setSequenceParams(const long bitPlanes, const long pictureOffset);
+	void setAreaOfInterest(const long firstRow, const long rows);
+	int setBitNum(const long bitNum);
 	void setTimingParams(const unsigned long illuminateTime, const unsigned long pictureTime, const unsigned long synchDelay, const unsigned long synchPulseWidth, const unsigned long triggerInDelay);
+	void setLEDType(long LEDType);
+	void setTelemetry(const unsigned long rate, const std::filesystem::path& logPath = {});
+	void setThermalLimit(const double ceiling, const double kp = 10., const double ki = 2.5);
+	void setInteractive(bool interactive, unsigned long runTime = 0);
+
+	void requestStop();
+	void requestSequence(const ALP_ID seqId);
+	void requestBrightness(const long brightness);
 
 	bool checkLEDExceedsLimits() const;
 
 private:
-	int initializeProjector();
-
 	int initializeLED();
 
 	int display();
+	int applyCommand(tAlpCommand const& command, long& LEDBrightness, bool& stop);
+	int haltProjection();
+	std::jthread watchKeyboard();
+
+	int renderSequence(std::function<void(AlpFrames&, long)> const& render, ALP_ID& seqId, unsigned threads = 0);
+
+	int uploadSequence(AlpFrames& image, ALP_ID& seqId);
+
+	int selectRows(const ALP_ID seqId, const long firstRow, const long rows);
+	int selectBitNum(const ALP_ID seqId);
+	long activeRows() const;
+
+	int updateStreamSlots(unsigned long& waitTime);
+
+	struct StreamSlot {
+		ALP_ID sequenceId, queueId;
+		bool queued;
+	};
+
+	struct CachedSequence {
+		ALP_ID sequenceId;
+		std::vector<unsigned long> timing;
+		long bitNum;
+	};
+
+	// The frames a sequence was loaded from, see updateSequence; once updated, the sequence
+	// leaves _sequenceCache (its key no longer matches) and is found through `source` only
+	struct UploadedFrames {
+		const AlpFrames* source;
+		unsigned long long mark, key;
+		bool keyed;
+		CachedSequence updated;
+		long frameCount, width, height, firstRow, bitPlanes, pictureOffset;
+		AlpFrames::PixelFormat format;
+	};
+
+	int cacheLookup(CachedSequence& cached, ALP_ID& seqId);
+	UploadedFrames* findUpload(AlpFrames const& image, const long bitPlanes);
 
 	/**
 	* @var AlpDevId, AlpSeqId, AlpLedId
@@ -98,6 +206,42 @@ private:
 	*
 	* @var _sleepTime, deviceNum, initFlag
 	* @brief Sleep time within loop [s], Device number, Initialization flag
+	*
+	* @var _interactive, _runTime
+	* @brief Prompt for LED type/brightness and wait for a key press, Projection time when not interactive [ms]
+	*
+	* @var _deviceAllocated, _streamSlots, _streamFrames
+	* @brief AlpDevAlloc succeeded, Sequences rotating through the sequence queue while streaming, Frames per streamed sequence
+	*
+	* @var _LEDAllocated, _sequenceCache, _cacheHits, _cacheMisses
+	* @brief AlpLedAlloc succeeded, Resident sequences by pattern key, Lookups answered from the cache, Lookups that rendered and uploaded
+	*
+	* @var _aoiFirstRow, _aoiRows, _minPictureTime
+	* @brief First DMD row and number of rows of new sequences (0 rows: whole DMD), ALP_MIN_PICTURE_TIME of the last sequence allocated [μs]
+	*
+	* @var _bitNum
+	* @brief Bit planes displayed of gray sequences (ALP_BITNUM), 0 for all
+	*
+	* @var _telemetry, _telemetryRate, _telemetryLog
+	* @brief Samples the LED on a background thread once it is allocated, Samples per second (0: off), File the samples are appended to
+	*
+	* @var _thermal
+	* @brief Adjusts the LED brightness during display to keep the junction below a ceiling
+	*
+	* @var _commands
+	* @brief Stop, sequence and brightness requests from other threads, applied by display as they arrive
+	*
+	* @var _triggeredFrames, _triggeredTime, _missedTriggers
+	* @brief Of the last projectTriggered: frames completed, time from the start until the end of the projection [μs],
+	* triggers without effect (0 without a trigger count)
+	*
+	* @var _uploads, _updates, _updatedFrames, _skippedFrames
+	* @brief Source frames, generation mark and cache key of the sequences loaded by cachedSequence, updateSequence calls that
+	* found a resident sequence, Frames they loaded, Frames they left in place because they had not changed
+	*
+	* @var _memory, _projectedSeqId
+	* @brief Allocates all sequences, evicting the least recently projected ones when the on-board memory is full,
+	* Sequence started by the last switchSequence, pinned in `_memory`; ALP_INVALID_ID once halted (haltProjection)
 	*/
 
 	ALP_ID AlpDevId, AlpSeqId, AlpLedId;
@@ -106,7 +250,32 @@ private:
 		_LEDContCurrent, _LEDCurrent, _LEDJunctionTemp, deviceNum, initFlag, _LEDType;
 
 	unsigned long _illuminateTime, _pictureTime, _synchDelay,
-		_synchPulseWidth, _triggerInDelay, _sleepTime;
+		_synchPulseWidth, _triggerInDelay, _sleepTime, _runTime;
+
+	bool _interactive, _deviceAllocated, _LEDAllocated;
+
+	std::vector<StreamSlot> _streamSlots;
+	long _streamFrames;
+
+	long _aoiFirstRow, _aoiRows, _minPictureTime, _bitNum;
+
+	std::unordered_map<unsigned long long, CachedSequence> _sequenceCache;
+	unsigned long _cacheHits, _cacheMisses;
+
+	std::unordered_map<ALP_ID, UploadedFrames> _uploads;
+	unsigned long _updates, _updatedFrames, _skippedFrames;
+
+	AlpLedTelemetry _telemetry;
+	unsigned long _telemetryRate;
+	std::filesystem::path _telemetryLog;
+
+	AlpThermalController _thermal;
+
+	AlpCommandQueue _commands;
+	unsigned long _triggeredFrames, _triggeredTime, _missedTriggers;
+
+	AlpSequenceMemory _memory;
+	ALP_ID _projectedSeqId;
 
 	tAlpHldPt120AllocParams _LEDParams;
 	tAlpDynSynchOutGate _AlpSynchGate;
@@ -1,5 +1,16 @@
-
 #include "Projector.h"
+#include "Benchmark.h"
+#include "AlpSimulatedCamera.h"
+#ifdef ALP_EMULATOR
+#include "AlpEmulator.h"
+#endif
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 
 const long frames = 1;
@@ -7,7 +18,275 @@ const long spacing = 4;
 const unsigned long pictureTime = 10000;
 const long brightness = 100;
 
-int main() {
+int main(int argc, char* argv[]) {
+	// --bench-frames <results.json> [MB]: time all AlpFrames primitives, skipping cases needing more than [MB] of frames
+	if (argc >= 3 && strcmp(argv[1], "--bench-frames") == 0)
+		return benchmarkFrames(argv[2], (argc >= 4 ? strtoul(argv[3], nullptr, 10) : 1024) << 20);
+	// --bench-decode [width height]: decode synthetic structured-light captures of a camera with this resolution
+	if (argc >= 2 && strcmp(argv[1], "--bench-decode") == 0)
+		return benchmarkDecoding(argc >= 4 ? strtol(argv[2], nullptr, 10) : 1280, argc >= 4 ? strtol(argv[3], nullptr, 10) : 1024);
+	if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+		benchmarkPacking();
+		benchmarkSlicing();
+		return 0;
+	}
+
 	Projector P;
-	P.generatePattern(frames, spacing, pictureTime, brightness);
-}
\ No newline at end of file
+
+	// --headless <ms>: no console prompts, project for <ms> milliseconds
+	if (argc >= 3 && strcmp(argv[1], "--headless") == 0)
+		P.setInteractive(false, strtoul(argv[2], nullptr, 10));
+
+	int result = 0;
+	// --stream <sequences>: no console prompts, stream <sequences> moving-square sequences back to back
+	if (argc >= 3 && strcmp(argv[1], "--stream") == 0) {
+		const long streamFrames = 10, sequences = strtol(argv[2], nullptr, 10);
+		P.setInteractive(false);
+		P.setImageDataParams(streamFrames, spacing, pictureTime, brightness);
+		result = P.startStreaming(streamFrames);
+		for (long i = 0; result == 0 && i < sequences; i++) {
+			AlpFrames chunk(streamFrames, P.getWidth(), P.getHeight(), AlpFrames::PixelFormat::Binary);
+			result = chunk.drawMovingSquare(streamFrames, P.getWidth(), P.getHeight());
+			if (result == 0)
+				result = P.streamPattern(chunk);
+		}
+		if (result == 0)
+			result = P.stopStreaming();
+	}
+	// --scroll <lineInc> <ms>: no console prompts, scroll a bar across the DMD for <ms> milliseconds
+	else if (argc >= 4 && strcmp(argv[1], "--scroll") == 0) {
+		const long lineInc = strtol(argv[2], nullptr, 10);
+		P.setInteractive(false, strtoul(argv[3], nullptr, 10));
+		P.setImageDataParams(2, spacing, pictureTime, brightness);
+		result = P.initializeProjector();
+		if (result == 0) {
+			// two frames instead of one per bar position, see AlpFrames::drawScrollingBar
+			const long barHeight = P.getHeight() / 5;
+			AlpFrames strip(2, P.getWidth(), P.getHeight(), AlpFrames::PixelFormat::Binary);
+			strip.drawScrollingBar(barHeight);
+			result = P.scrollPattern(strip, barHeight, P.getHeight(), lineInc);
+		}
+	}
+	// --aoi <firstRow> <rows> <ms>: no console prompts, project the pattern on a band of rows for <ms> milliseconds
+	else if (argc >= 5 && strcmp(argv[1], "--aoi") == 0) {
+		P.setInteractive(false, strtoul(argv[4], nullptr, 10));
+		P.setAreaOfInterest(strtol(argv[2], nullptr, 10), strtol(argv[3], nullptr, 10));
+		result = P.generatePattern(frames, spacing, pictureTime, brightness);
+	}
+	// --gray <bitPlanes> <bitNum> <ms>: no console prompts, project a gray ramp for <ms> milliseconds,
+	// then the same sequence again with only <bitNum> planes displayed
+	else if (argc >= 5 && strcmp(argv[1], "--gray") == 0) {
+		const long bitPlanes = strtol(argv[2], nullptr, 10), bitNum = strtol(argv[3], nullptr, 10);
+		P.setInteractive(false, strtoul(argv[4], nullptr, 10));
+		P.setImageDataParams(1, spacing, pictureTime, brightness);
+		P.setSequenceParams(bitPlanes, 0);
+		result = P.initializeProjector();
+		if (result == 0) {
+			AlpFrames ramp(1, P.getWidth(), P.getHeight());
+			ramp.drawGrayRamp(1, bitPlanes);
+			result = P.projectFrames(ramp);
+			_tprintf(_T("%ld bit planes: minimum picture time %lu us\r\n"), bitPlanes, P.getMinPictureTime());
+			if (result == 0)
+				result = P.setBitNum(bitNum);
+			if (result == 0)
+				result = P.projectFrames(ramp);
+			_tprintf(_T("%ld of %ld bit planes: minimum picture time %lu us\r\n"), bitNum, bitPlanes, P.getMinPictureTime());
+		}
+	}
+	// --save <path> <frames>: no console prompts, write a moving-square sequence of <frames> frames to a
+	// sequence file, to be projected with --files
+	else if (argc >= 4 && strcmp(argv[1], "--save") == 0) {
+		const long saveFrames = strtol(argv[3], nullptr, 10);
+		P.setInteractive(false);
+		P.setImageDataParams(saveFrames, spacing, pictureTime, brightness);
+		result = P.initializeProjector();
+		if (result == 0) {
+			AlpFrames sequence(saveFrames, P.getWidth(), P.getHeight(), AlpFrames::PixelFormat::Binary);
+			result = sequence.drawMovingSquare(saveFrames, P.getWidth(), P.getHeight());
+			if (result == 0)
+				result = sequence.writeSequenceFile(argv[2], 1, P.getTimingParams());
+		}
+	}
+	// --telemetry <rate> <log> <ms>: no console prompts, project the pattern for <ms> milliseconds while
+	// sampling the LED <rate> times per second into <log> (.csv for text)
+	else if (argc >= 5 && strcmp(argv[1], "--telemetry") == 0) {
+		P.setInteractive(false, strtoul(argv[4], nullptr, 10));
+		P.setTelemetry(strtoul(argv[2], nullptr, 10), argv[3]);
+		result = P.generatePattern(frames, spacing, pictureTime, brightness);
+		tAlpLedSample sample;
+		std::vector<unsigned long> const telemetry = P.getTelemetryStats();
+		if (result == 0 && P.getLEDTelemetry(sample))
+			_tprintf(_T("Telemetry: %lu samples, %lu dropped, last %0.1f A at %0.2f \370C\r\n"),
+				telemetry[0], telemetry[1], (double)sample.Current / 1000, (double)sample.JunctionTemp / 256);
+	}
+	// --thermal <ceiling> <ms>: no console prompts, project the pattern for <ms> milliseconds, derating
+	// the LED to keep its junction below <ceiling> degrees Celsius
+	else if (argc >= 4 && strcmp(argv[1], "--thermal") == 0) {
+		P.setInteractive(false, strtoul(argv[3], nullptr, 10));
+		P.setThermalLimit(strtod(argv[2], nullptr));
+		result = P.generatePattern(frames, spacing, pictureTime, brightness);
+	}
+	// --control <ms>: no console prompts, project the pattern while another thread halves the brightness
+	// after <ms>/2 and stops the projection after <ms> milliseconds, then print the reaction times
+	else if (argc >= 3 && strcmp(argv[1], "--control") == 0) {
+		unsigned long const controlTime = strtoul(argv[2], nullptr, 10);
+		// only a safety net, the stop request ends the projection long before
+		P.setInteractive(false, 10 * controlTime + 1000);
+		std::thread controller([&P, controlTime] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(controlTime / 2));
+			P.requestBrightness(brightness / 2);
+			std::this_thread::sleep_for(std::chrono::milliseconds(controlTime - controlTime / 2));
+			P.requestStop();
+		});
+		result = P.generatePattern(frames, spacing, pictureTime, brightness);
+		controller.join();
+		std::vector<unsigned long> const control = P.getControlStats();
+		_tprintf(_T("Control: %lu commands, reaction mean %lu us, max %lu us\r\n"), control[0], control[1], control[2]);
+	}
+	// --step <frames> <fps> <pictureTime> [slave]: no console prompts, project <frames> moving-square frames
+	// in step (or slave) mode, advanced by a simulated camera exposing at <fps> frames per second
+	else if (argc >= 5 && strcmp(argv[1], "--step") == 0) {
+		const long stepFrames = strtol(argv[2], nullptr, 10);
+		const double frameRate = strtod(argv[3], nullptr);
+		const long mode = argc >= 6 && strcmp(argv[5], "slave") == 0 ? ALP_SLAVE : ALP_PROJ_STEP;
+		// only a safety net, the camera ends the projection with its last exposure
+		P.setInteractive(false, (unsigned long)(stepFrames * 2000 / frameRate) + 1000);
+		P.setImageDataParams(stepFrames, spacing, strtoul(argv[4], nullptr, 10), brightness);
+		P.setTimingParams(0, strtoul(argv[4], nullptr, 10), 0, 0, 0);
+		result = P.initializeProjector();
+		AlpSimulatedCamera camera;
+		if (result == 0) {
+			AlpFrames sequence(stepFrames, P.getWidth(), P.getHeight(), AlpFrames::PixelFormat::Binary);
+			result = sequence.drawMovingSquare(stepFrames, P.getWidth(), P.getHeight());
+			// the camera exposes half of each frame period and triggers at the end of the exposure
+			if (result == 0)
+				result = P.projectTriggered(sequence, mode, ALP_EDGE_RISING, [&] {
+#ifdef ALP_EMULATOR
+					camera.start(frameRate, (unsigned long)(5e5 / frameRate), [&P] { AlpEmuTrigger(P.getDeviceId()); }, stepFrames);
+#endif
+				}, [&camera] { return camera.exposureCount(); });
+		}
+		camera.stop();
+#ifdef ALP_EMULATOR
+		tAlpEmuTriggerStats triggers;
+		AlpEmuTriggerStats(triggers);
+		// the latency is only known to the emulator
+		_tprintf(_T("Camera: %llu exposures, jitter up to %0.1f us; trigger to frame %0.1f us mean, %0.1f us max; %llu missed\r\n"),
+			camera.exposureCount(), camera.maxJitter(), triggers.MeanLatency, triggers.MaxLatency, triggers.Missed);
+#endif
+	}
+	// --structured <ms>: no console prompts, project column and row Gray-code sets with inverses and two
+	// 4-step phase-shift sets for <ms> milliseconds
+	else if (argc >= 3 && strcmp(argv[1], "--structured") == 0) {
+		P.setInteractive(false, strtoul(argv[2], nullptr, 10));
+		result = P.initializeProjector();
+		if (result == 0) {
+			const long columnBits = AlpFrames::grayCodeBits(P.getWidth()), rowBits = AlpFrames::grayCodeBits(P.getHeight());
+			const long steps = 4, period = 32, patterns = 2 * columnBits + 2 * rowBits + 2 * steps;
+			AlpFrames sequence(patterns, P.getWidth(), P.getHeight(), AlpFrames::PixelFormat::Binary);
+			auto const start = std::chrono::steady_clock::now();
+			if (sequence.drawGrayCode(0, columnBits, true) != 0 || sequence.drawGrayCode(2 * columnBits, rowBits, false) != 0
+				|| sequence.drawPhaseShift(2 * columnBits + 2 * rowBits, steps, period, true) != 0
+				|| sequence.drawPhaseShift(2 * columnBits + 2 * rowBits + steps, steps, period, false) != 0)
+				result = 1;
+			if (result == 0) {
+				_tprintf(_T("Structured light: %li patterns generated in %0.2f ms\r\n"), patterns,
+					std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+				P.setImageDataParams(patterns, spacing, pictureTime, brightness);
+				result = P.projectFrames(sequence);
+			}
+		}
+	}
+	// --update <frames> <ms>: no console prompts, load a moving-square sequence of <frames> frames, edit one
+	// frame and load it again (only the edited frame is transferred), then project it for <ms> milliseconds
+	else if (argc >= 4 && strcmp(argv[1], "--update") == 0) {
+		const long updateFrames = strtol(argv[2], nullptr, 10);
+		P.setInteractive(false, strtoul(argv[3], nullptr, 10));
+		P.setImageDataParams(updateFrames, spacing, pictureTime, brightness);
+		result = P.initializeProjector();
+		if (result == 0) {
+			AlpFrames sequence(updateFrames, P.getWidth(), P.getHeight(), AlpFrames::PixelFormat::Binary);
+			ALP_ID seqId;
+			result = sequence.drawMovingSquare(updateFrames, P.getWidth(), P.getHeight());
+			if (result == 0)
+				result = P.updateSequence(sequence, seqId);
+			if (result == 0) {
+				result = sequence.fillRect(updateFrames / 2, 0, 0, P.getWidth() / 4, P.getHeight() / 4, 255);
+				if (result == 0)
+					result = P.updateSequence(sequence, seqId);
+			}
+			if (result == 0) {
+				std::vector<unsigned long> const updates = P.getUpdateStats();
+				_tprintf(_T("Updates: %lu, %lu frames loaded, %lu unchanged frames skipped\r\n"), updates[0], updates[1], updates[2]);
+				result = P.projectFrames(sequence);
+			}
+		}
+	}
+	// --profile <trace.json> <ms>: no console prompts, project the pattern for <ms> milliseconds while
+	// recording a Chrome trace, then print the latencies of the ALP calls
+	else if (argc >= 4 && strcmp(argv[1], "--profile") == 0) {
+		P.setInteractive(false, strtoul(argv[3], nullptr, 10));
+		AlpTraceStart();
+		result = P.generatePattern(frames, spacing, pictureTime, brightness);
+		AlpProfilerDump();
+		if (AlpTraceWrite(argv[2]) != 0)
+			result = 1;
+	}
+	// --files <path> <ms>: no console prompts, project a PGM file, a raw file with the DMD dimensions,
+	// a directory of them, or a sequence file (.alpseq) for <ms> milliseconds
+	else if (argc >= 4 && strcmp(argv[1], "--files") == 0) {
+		const std::filesystem::path path = argv[2];
+		P.setInteractive(false, strtoul(argv[3], nullptr, 10));
+		P.setImageDataParams(1, spacing, pictureTime, brightness);
+		result = P.initializeProjector();
+		AlpImageFiles files;
+		if (result == 0) {
+			if (std::filesystem::is_directory(path))
+				result = files.openDirectory(path, P.getWidth(), P.getHeight());
+			else if (path.extension() == ".alpseq")
+				result = files.openSequence(path);
+			else if (path.extension() == ".raw")
+				result = files.openRaw(path, P.getWidth(), P.getHeight());
+			else
+				result = files.openPgm(path);
+		}
+		if (result == 0)
+			result = P.projectFiles(files);
+	}
+	// --input <gray|binary> <frames> [fifo]: no console prompts, stream raw frames from a FIFO or stdin
+	// in sequences of <frames> frames until the input ends
+	else if (argc >= 4 && strcmp(argv[1], "--input") == 0) {
+		const long streamFrames = strtol(argv[3], nullptr, 10);
+		const AlpFrames::PixelFormat format = strcmp(argv[2], "binary") == 0 ? AlpFrames::PixelFormat::Binary : AlpFrames::PixelFormat::Gray8;
+		std::FILE* input = argc >= 5 ? std::fopen(argv[4], "rb") : stdin;
+#ifdef _WIN32
+		if (input == stdin)
+			_setmode(_fileno(stdin), _O_BINARY);
+#endif
+		P.setInteractive(false);
+		P.setImageDataParams(streamFrames, spacing, pictureTime, brightness);
+		if (input == nullptr) {
+			std::cerr << "Error: Cannot open " << argv[4] << "." << std::endl;
+			result = 1;
+		}
+		else
+			result = P.streamInput(input, format, streamFrames);
+		if (input != nullptr && input != stdin)
+			std::fclose(input);
+	}
+	else
+		result = P.generatePattern(frames, spacing, pictureTime, brightness);
+
+	tAlpSeqMemoryStats memory;
+	if (result == 0 && P.getMemoryStats(memory) == 0)
+		_tprintf(_T("Sequence memory: %ld of %ld binary pictures used by %lu sequences, %lu evictions\r\n"),
+			memory.Used, memory.Capacity, memory.Sequences, memory.Evictions);
+
+#ifdef ALP_EMULATOR
+	tAlpEmuTimingReport report;
+	if (AlpEmuTimingReport(ALP_INVALID_ID, report) == ALP_OK)
+		_tprintf(_T("Emulator: %lu frame switches, picture time requested %.1f us, mean %.1f us, max %.1f us, %lu gaps\r\n"),
+			report.Frames, report.RequestedPictureTime, report.MeanPictureTime, report.MaxPictureTime, report.Gaps);
+#endif
+	return result;
+}
@@ -5,11 +5,26 @@
 
 #pragma once
 
+#ifdef _WIN32
 #include "targetver.h"
 
 #include <stdio.h>
 #include <tchar.h>
+#define NOMINMAX
 #include <windows.h>
+#else
+// There is no ALP driver outside of Windows, so always build against the emulator.
+#ifndef ALP_EMULATOR
+#define ALP_EMULATOR
+#endif
+#include "PlatformCompat.h"
+#endif
+
+// The emulator (AlpEmulator.cpp) implements the ALP API in-process instead of importing it from alpV42.dll
+#if defined(ALP_EMULATOR) && !defined(ALP_API)
+#define ALP_API extern "C"
+#define ALP_ATTR
+#endif
 
 
 